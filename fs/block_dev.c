@@ -11,8 +11,9 @@
 #include <asm/segment.h>
 #include <asm/system.h>
 
-int block_write(int dev, long * pos, char * buf, int count)
+int block_write(int dev, long * pos, struct uio * uio)
 {
+	int count = uio->u_count;
 	int block = *pos >> BLOCK_SIZE_BITS;
 	int offset = *pos & (BLOCK_SIZE-1);
 	int chars;
@@ -36,16 +37,16 @@ int block_write(int dev, long * pos, char * buf, int count)
 		*pos += chars;
 		written += chars;
 		count -= chars;
-		while (chars-->0)
-			*(p++) = get_fs_byte(buf++);
+		uio_get(uio,p,chars);
 		bh->b_dirt = 1;
 		brelse(bh);
 	}
 	return written;
 }
 
-int block_read(int dev, unsigned long * pos, char * buf, int count)
+int block_read(int dev, unsigned long * pos, struct uio * uio)
 {
+	int count = uio->u_count;
 	int block = *pos >> BLOCK_SIZE_BITS;
 	int offset = *pos & (BLOCK_SIZE-1);
 	int chars;
@@ -65,8 +66,7 @@ int block_read(int dev, unsigned long * pos, char * buf, int count)
 		*pos += chars;
 		read += chars;
 		count -= chars;
-		while (chars-->0)
-			put_fs_byte(*(p++),buf++);
+		uio_put(uio,p,chars);
 		brelse(bh);
 	}
 	return read;
@@ -18,6 +18,15 @@
  * invalidate changed floppy-disk-caches.
  */
 
+/*
+ * The buffers set up by buffer_init() are only the minimum: while there
+ * is free memory, getblk() adds whole pages of buffers taken from
+ * get_free_page() rather than throwing out cached blocks, and
+ * get_free_page() calls shrink_buffers() to take such pages back when
+ * it runs out. The buffer heads for these live in pages of their own,
+ * which are never given back.
+ */
+
 #include <stdarg.h>
  
 #include <linux/config.h>
@@ -30,9 +39,31 @@ extern int end;
 struct buffer_head * start_buffer = (struct buffer_head *) &end; //设置高速缓冲区首地址为end处
 struct buffer_head * hash_table[NR_HASH]; //哈希表
 static struct buffer_head * free_list; //设置空闲链表头
-static struct task_struct * buffer_wait = NULL; //等待空闲缓冲块而睡眠的队列
+static struct wait_queue * buffer_wait = NULL; //等待空闲缓冲块而睡眠的队列
 int NR_BUFFERS = 0;
 
+#define MIN_FREE_PAGES 64
+#define BH_PER_PAGE (PAGE_SIZE/sizeof(struct buffer_head))
+#define NR_BH_CHUNKS (1+(PAGING_PAGES*(PAGE_SIZE/BLOCK_SIZE))/BH_PER_PAGE+1)
+
+/*
+ * Every buffer head there is can be found through bh_chunks[]: chunk 0
+ * is the static array at start_buffer, the others are pages of heads.
+ * Heads that don't have a buffer have b_data == NULL, and are kept on
+ * unused_list (linked through b_next_free).
+ */
+static struct bh_chunk {
+	struct buffer_head * bh;
+	int nr;
+} bh_chunks[NR_BH_CHUNKS];
+static int nr_bh_chunks = 0;
+static struct buffer_head * unused_list = NULL;
+static int nr_unused = 0;
+
+/* bread()s and breada()s that did/didn't find the block in the cache */
+unsigned long buffer_hits = 0;
+unsigned long buffer_misses = 0;
+
 static inline void wait_on_buffer(struct buffer_head * bh) //等待当前缓冲区完成读写操作，此时lock为1 //多线程中同步操作
 {
 	cli(); //禁止中断发生
@@ -44,56 +75,57 @@ static inline void wait_on_buffer(struct buffer_head * bh) //等待当前缓冲
 int sys_sync(void) //同步高速缓存区与磁盘块的内容
 {
 	int i;
+	struct bh_chunk * c;
 	struct buffer_head * bh;
 
 	sync_inodes();		/* write out inodes into buffers */
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
-		wait_on_buffer(bh);
-		if (bh->b_dirt)
-			ll_rw_block(WRITE,bh); 
-	}
+	for (c = bh_chunks ; c < bh_chunks + nr_bh_chunks ; c++)
+		for (i=0,bh=c->bh ; i<c->nr ; i++,bh++) {
+			wait_on_buffer(bh);
+			if (bh->b_dirt)
+				ll_rw_block(WRITE,bh);
+		}
 	return 0;
 }
 
-int sync_dev(int dev)
+static void write_dev_buffers(int dev)
 {
 	int i;
+	struct bh_chunk * c;
 	struct buffer_head * bh;
 
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
-		if (bh->b_dev != dev)
-			continue;
-		wait_on_buffer(bh);
-		if (bh->b_dev == dev && bh->b_dirt)
-			ll_rw_block(WRITE,bh);
-	}
+	for (c = bh_chunks ; c < bh_chunks + nr_bh_chunks ; c++)
+		for (i=0,bh=c->bh ; i<c->nr ; i++,bh++) {
+			if (bh->b_dev != dev)
+				continue;
+			wait_on_buffer(bh);
+			if (bh->b_dev == dev && bh->b_dirt)
+				ll_rw_block(WRITE,bh);
+		}
+}
+
+int sync_dev(int dev)
+{
+	write_dev_buffers(dev);
 	sync_inodes();
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
-		if (bh->b_dev != dev)
-			continue;
-		wait_on_buffer(bh);
-		if (bh->b_dev == dev && bh->b_dirt)
-			ll_rw_block(WRITE,bh);
-	}
+	write_dev_buffers(dev);
 	return 0;
 }
 
 void inline invalidate_buffers(int dev)
 {
 	int i;
+	struct bh_chunk * c;
 	struct buffer_head * bh;
 
-	bh = start_buffer;
-	for (i=0 ; i<NR_BUFFERS ; i++,bh++) {
-		if (bh->b_dev != dev)
-			continue;
-		wait_on_buffer(bh);
-		if (bh->b_dev == dev)
-			bh->b_uptodate = bh->b_dirt = 0;
-	}
+	for (c = bh_chunks ; c < bh_chunks + nr_bh_chunks ; c++)
+		for (i=0,bh=c->bh ; i<c->nr ; i++,bh++) {
+			if (bh->b_dev != dev)
+				continue;
+			wait_on_buffer(bh);
+			if (bh->b_dev == dev)
+				bh->b_uptodate = bh->b_dirt = 0;
+		}
 }
 
 /*
@@ -195,6 +227,150 @@ struct buffer_head * get_hash_table(int dev, int block)
 	}
 }
 
+/*
+ * get_more_buffer_heads() makes sure there are at least 'nr' heads on
+ * the unused list. The page for them is only taken while memory is
+ * plentiful, so this never has to wait.
+ */
+static int get_more_buffer_heads(int nr)
+{
+	struct buffer_head * bh;
+	int i;
+
+	if (nr_unused >= nr)
+		return 1;
+	if (nr_free_pages < MIN_FREE_PAGES || nr_bh_chunks >= NR_BH_CHUNKS)
+		return 0;
+	if (!(bh = (struct buffer_head *) get_free_page()))
+		return 0;
+	bh_chunks[nr_bh_chunks].bh = bh;
+	bh_chunks[nr_bh_chunks].nr = BH_PER_PAGE;
+	nr_bh_chunks++;
+	for (i=0 ; i<BH_PER_PAGE ; i++,bh++) {
+		bh->b_next_free = unused_list;
+		unused_list = bh;
+		nr_unused++;
+	}
+	return 1;
+}
+
+/*
+ * grow_buffers() adds a page worth of free buffers to the front of the
+ * free list, so that getblk() finds them first.
+ */
+static int grow_buffers(void)
+{
+	struct buffer_head * bh, * first, * prev;
+	unsigned long page;
+	int i;
+
+	if (nr_free_pages < MIN_FREE_PAGES)
+		return 0;
+	if (!get_more_buffer_heads(PAGE_SIZE/BLOCK_SIZE))
+		return 0;
+	if (!(page = get_free_page()))
+		return 0;
+	first = prev = NULL;
+	for (i=0 ; i<PAGE_SIZE/BLOCK_SIZE ; i++,page += BLOCK_SIZE) {
+		bh = unused_list;
+		unused_list = bh->b_next_free;
+		nr_unused--;
+		bh->b_dev = 0;
+		bh->b_dirt = 0;
+		bh->b_count = 0;
+		bh->b_lock = 0;
+		bh->b_uptodate = 0;
+		bh->b_wait = NULL;
+		bh->b_data = (char *) page;
+		if (prev)
+			prev->b_this_page = bh;
+		else
+			first = bh;
+		prev = bh;
+		insert_into_queues(bh);
+		NR_BUFFERS++;
+	}
+	prev->b_this_page = first;
+	free_list = first;
+	return 1;
+}
+
+static int page_unused(struct buffer_head * bh, int dirty_ok)
+{
+	struct buffer_head * tmp = bh;
+
+	do {
+		if (tmp->b_count || tmp->b_lock || (tmp->b_dirt && !dirty_ok))
+			return 0;
+		tmp = tmp->b_this_page;
+	} while (tmp != bh);
+	return 1;
+}
+
+static void free_buffer_page(struct buffer_head * bh)
+{
+	struct buffer_head * tmp, * next;
+	unsigned long page;
+
+	page = (unsigned long) bh->b_data & 0xfffff000;
+	tmp = bh;
+	do {
+		next = tmp->b_this_page;
+		remove_from_queues(tmp);
+		tmp->b_dev = 0;
+		tmp->b_uptodate = 0;
+		tmp->b_data = NULL;
+		tmp->b_this_page = NULL;
+		tmp->b_next_free = unused_list;
+		unused_list = tmp;
+		nr_unused++;
+		NR_BUFFERS--;
+		tmp = next;
+	} while (tmp != bh);
+	free_page(page);
+}
+
+/*
+ * shrink_buffers() is called by get_free_page() when memory has run
+ * out. It gives back the least recently used page of buffers that
+ * nobody is using. Clean pages are preferred: if there aren't any, the
+ * oldest unused dirty page is written out first. Returns 1 if it freed
+ * a page.
+ */
+int shrink_buffers(void)
+{
+	struct buffer_head * bh, * dirty = NULL;
+	struct buffer_head * arr[PAGE_SIZE/BLOCK_SIZE];
+	int i;
+
+	bh = free_list;
+	for (i = NR_BUFFERS ; i-- > 0 ; bh = bh->b_next_free) {
+		if (!bh->b_this_page)
+			continue;
+		if (page_unused(bh,0)) {
+			free_buffer_page(bh);
+			return 1;
+		}
+		if (!dirty && page_unused(bh,1))
+			dirty = bh;
+	}
+	if (!(bh = dirty))
+		return 0;
+/* the page may go away while we sleep, so remember its buffers first */
+	for (i=0 ; i<PAGE_SIZE/BLOCK_SIZE ; i++,bh = bh->b_this_page)
+		arr[i] = bh;
+	for (i=0 ; i<PAGE_SIZE/BLOCK_SIZE ; i++)
+		if (arr[i]->b_dirt)
+			ll_rw_block(WRITE,arr[i]);
+	for (i=0 ; i<PAGE_SIZE/BLOCK_SIZE ; i++)
+		wait_on_buffer(arr[i]);
+/* we slept: check that nobody grabbed (or freed) it meanwhile */
+	if (!bh->b_this_page || !page_unused(bh,0))
+		return 0;
+	free_buffer_page(bh);
+	return 1;
+}
+
 /*
  * Ok, this is getblk, and it isn't very clear, again to hinder
  * race-conditions. Most of the code is seldom used, (ie repeating),
@@ -223,17 +399,20 @@ repeat:
 		}
 /* and repeat until we find something good */
 	} while ((tmp = tmp->b_next_free) != free_list);
+/* rather than throw out a cached block, grow the cache if we can */
+	if ((!bh || bh->b_dev || BADNESS(bh)) && grow_buffers())
+		goto repeat;
 	if (!bh) {   //如果没找到，
-		sleep_on(&buffer_wait); //该进程进入深度睡眠，进行等待 等待队列实现方式
+		sleep_on_exclusive(&buffer_wait); //该进程进入深度睡眠，进行等待 等待队列实现方式
 		goto repeat; //进程激活后重新检索，因为可能睡眠的过程中，此缓冲块被其他进程使用
 	}
 	wait_on_buffer(bh);  //如果上锁，等待解锁
-	if (bh->b_count) //再次确保等待过程中高速缓冲区未被使用
+	if (bh->b_count || !bh->b_data) //再次确保等待过程中高速缓冲区未被使用
 		goto repeat;
 	while (bh->b_dirt) {
 		sync_dev(bh->b_dev); //如果空间是脏的话，同步（数据回写操作）
 		wait_on_buffer(bh);
-		if (bh->b_count)  //再次判断此缓冲块是否被其他进程占用
+		if (bh->b_count || !bh->b_data)  //再次判断此缓冲块是否被其他进程占用
 			goto repeat;
 	}
 /* NOTE!! While we slept waiting for this block, somebody else might */
@@ -260,7 +439,8 @@ void brelse(struct buffer_head * buf) //释放指定的高速缓存区
 	wait_on_buffer(buf);
 	if (!(buf->b_count--))
 		panic("Trying to free free buffer");
-	wake_up(&buffer_wait);  //唤醒等待队列的进程
+	if (!buf->b_count)
+		wake_up_one(&buffer_wait);  //唤醒等待队列的进程
 }
 
 /*
@@ -273,8 +453,11 @@ struct buffer_head * bread(int dev,int block) //从设备上读取指定的数
 
 	if (!(bh=getblk(dev,block)))
 		panic("bread: getblk returned NULL\n");
-	if (bh->b_uptodate)
+	if (bh->b_uptodate) {
+		buffer_hits++;
 		return bh;
+	}
+	buffer_misses++;
 	ll_rw_block(READ,bh); //通过块设备读写函数，进行块设备与缓冲块的同步
 	wait_on_buffer(bh);
 	if (bh->b_uptodate)  //再次判断缓冲块是否有效（即块设备数据是否写入缓冲块）
@@ -294,12 +477,12 @@ __asm__("cld\n\t" \
  * bread_page reads four buffers into memory at the desired address. It's
  * a function of its own, as there is some speed to be got by reading them
  * all at the same time, not waiting for one to be read, and then another
- * etc.
+ * etc. It returns 0 if any of the blocks couldn't be read.
  */
-void bread_page(unsigned long address,int dev,int b[4])
+int bread_page(unsigned long address,int dev,int b[4])
 {
 	struct buffer_head * bh[4];
-	int i;
+	int i, ok = 1;
 
 	for (i=0 ; i<4 ; i++)
 		if (b[i]) {
@@ -313,8 +496,30 @@ void bread_page(unsigned long address,int dev,int b[4])
 			wait_on_buffer(bh[i]);
 			if (bh[i]->b_uptodate)
 				COPYBLK((unsigned long) bh[i]->b_data,address);
+			else
+				ok = 0;
 			brelse(bh[i]);
 		}
+	return ok;
+}
+
+/*
+ * bwrite_page is the reverse of bread_page: it copies a page out into
+ * four buffers and starts writing them. It's used for swap files.
+ */
+void bwrite_page(unsigned long address,int dev,int b[4])
+{
+	struct buffer_head * bh;
+	int i;
+
+	for (i=0 ; i<4 ; i++,address += BLOCK_SIZE)
+		if (b[i] && (bh = getblk(dev,b[i]))) {
+			COPYBLK(address,(unsigned long) bh->b_data);
+			bh->b_uptodate = 1;
+			bh->b_dirt = 1;
+			ll_rw_block(WRITE,bh);
+			brelse(bh);
+		}
 }
 
 /*
@@ -330,8 +535,11 @@ struct buffer_head * breada(int dev,int first, ...)
 	va_start(args,first);
 	if (!(bh=getblk(dev,first)))
 		panic("bread: getblk returned NULL\n");
-	if (!bh->b_uptodate)
+	if (!bh->b_uptodate) {
+		buffer_misses++;
 		ll_rw_block(READ,bh);
+	} else
+		buffer_hits++;
 	while ((first=va_arg(args,int))>=0) {
 		tmp=getblk(dev,first);
 		if (tmp) {
@@ -348,6 +556,32 @@ struct buffer_head * breada(int dev,int first, ...)
 	return (NULL);
 }
 
+/*
+ * For /proc: how many buffers there are, and how many of them are in
+ * use, dirty and locked right now.
+ */
+void buffer_stats(int * total, int * used, int * dirty, int * locked)
+{
+	struct buffer_head * bh;
+	int i,j;
+
+	*total = *used = *dirty = *locked = 0;
+	for (i=0 ; i<nr_bh_chunks ; i++) {
+		bh = bh_chunks[i].bh;
+		for (j=bh_chunks[i].nr ; j>0 ; j--,bh++) {
+			if (!bh->b_data)
+				continue;
+			(*total)++;
+			if (bh->b_count)
+				(*used)++;
+			if (bh->b_dirt)
+				(*dirty)++;
+			if (bh->b_lock)
+				(*locked)++;
+		}
+	}
+}
+
 void buffer_init(long buffer_end) //高速缓冲区初始化程序，实现哈希表与循环链表的创建
 {
 	struct buffer_head * h = start_buffer;
@@ -368,6 +602,7 @@ void buffer_init(long buffer_end) //高速缓冲区初始化程序，实现哈
 		h->b_next = NULL;
 		h->b_prev = NULL;
 		h->b_data = (char *) b;
+		h->b_this_page = NULL;
 		h->b_prev_free = h-1;
 		h->b_next_free = h+1;
 		h++;
@@ -375,6 +610,9 @@ void buffer_init(long buffer_end) //高速缓冲区初始化程序，实现哈
 		if (b == (void *) 0x100000)
 			b = (void *) 0xA0000;
 	}
+	bh_chunks[0].bh = start_buffer;
+	bh_chunks[0].nr = NR_BUFFERS;
+	nr_bh_chunks = 1;
 	h--;
 	free_list = start_buffer;
 	free_list->b_prev_free = h;
@@ -9,41 +9,89 @@
 
 #include <linux/sched.h>
 #include <linux/kernel.h>
+#include <linux/mm.h>
 
 #include <asm/segment.h>
 #include <asm/io.h>
 
-extern int tty_read(unsigned minor,char * buf,int count);
-extern int tty_write(unsigned minor,char * buf,int count);
+extern int tty_read(unsigned minor,char * buf,int count,int flags);
+extern int tty_write(unsigned minor,char * buf,int count,int flags);
+extern int tty_select(unsigned minor,int sel_type,select_table * wait);
 
-typedef (*crw_ptr)(int rw,unsigned minor,char * buf,int count,off_t * pos);
+typedef (*crw_ptr)(int rw,unsigned minor,char * buf,int count,off_t * pos,
+	int flags);
 
-static int rw_ttyx(int rw,unsigned minor,char * buf,int count,off_t * pos)
+static int rw_ttyx(int rw,unsigned minor,char * buf,int count,off_t * pos,
+	int flags)
 {
-	return ((rw==READ)?tty_read(minor,buf,count):
-		tty_write(minor,buf,count));
+	return ((rw==READ)?tty_read(minor,buf,count,flags):
+		tty_write(minor,buf,count,flags));
 }
 
-static int rw_tty(int rw,unsigned minor,char * buf,int count, off_t * pos)
+static int rw_tty(int rw,unsigned minor,char * buf,int count, off_t * pos,
+	int flags)
 {
 	if (current->tty<0)
 		return -EPERM;
-	return rw_ttyx(rw,current->tty,buf,count,pos);
+	return rw_ttyx(rw,current->tty,buf,count,pos,flags);
 }
 
+extern char * rd_start;
+extern int rd_length;
+
+/*
+ * Copies between user space and the 'size' bytes at 'base', at most a
+ * page at a time. Reading at or past the end gives 0, like a file does.
+ */
+static int rw_area(int rw, char * base, unsigned long size, char * buf,
+	int count, off_t * pos)
+{
+	unsigned long p = *pos;
+	int chars, done = 0;
+
+	if (count < 0)
+		return -EINVAL;
+	if (p >= size)
+		return (rw==READ) ? 0 : -ENOSPC;
+	if (count > size - p)
+		count = size - p;
+	while (count > 0) {
+		chars = PAGE_SIZE - (p & (PAGE_SIZE-1));
+		if (chars > count)
+			chars = count;
+		if (rw == READ)
+			memcpy_tofs(buf,base+p,chars);
+		else
+			memcpy_fromfs(base+p,buf,chars);
+		buf += chars;
+		p += chars;
+		done += chars;
+		count -= chars;
+	}
+	*pos = p;
+	return done;
+}
+
+/* /dev/ram is the ramdisk, if there is one */
 static int rw_ram(int rw,char * buf, int count, off_t *pos)
 {
-	return -EIO;
+	return rw_area(rw,rd_start,rd_length,buf,count,pos);
 }
 
+/* /dev/mem is physical memory, as far as we have it */
 static int rw_mem(int rw,char * buf, int count, off_t * pos)
 {
-	return -EIO;
+	return rw_area(rw,(char *) 0,HIGH_MEMORY,buf,count,pos);
 }
 
+/*
+ * /dev/kmem is the kernel's address space. The kernel segments start
+ * at 0 and physical memory is mapped 1:1, so this is the same as
+ * /dev/mem here: kernel symbols can be used as offsets directly.
+ */
 static int rw_kmem(int rw,char * buf, int count, off_t * pos)
 {
-	return -EIO;
+	return rw_area(rw,(char *) 0,HIGH_MEMORY,buf,count,pos);
 }
 
 static int rw_port(int rw,char * buf, int count, off_t * pos)
@@ -62,7 +110,8 @@ static int rw_port(int rw,char * buf, int count, off_t * pos)
 	return i;
 }
 
-static int rw_memory(int rw, unsigned minor, char * buf, int count, off_t * pos)
+static int rw_memory(int rw, unsigned minor, char * buf, int count,
+	off_t * pos, int flags)
 {
 	switch(minor) {
 		case 0:
@@ -92,7 +141,7 @@ static crw_ptr crw_table[]={
 	NULL,		/* /dev/lp */
 	NULL};		/* unnamed pipes */
 
-int rw_char(int rw,int dev, char * buf, int count, off_t * pos)
+int rw_char(int rw,int dev, char * buf, int count, off_t * pos, int flags)
 {
 	crw_ptr call_addr;
 
@@ -100,5 +149,23 @@ int rw_char(int rw,int dev, char * buf, int count, off_t * pos)
 		return -ENODEV;
 	if (!(call_addr=crw_table[MAJOR(dev)]))
 		return -ENODEV;
-	return call_addr(rw,MINOR(dev),buf,count,pos);
+	return call_addr(rw,MINOR(dev),buf,count,pos,flags);
+}
+
+/*
+ * Only ttys can make a reader or writer wait: everything else (memory,
+ * ports, null) is always ready.
+ */
+int char_select(int dev, int sel_type, select_table * wait)
+{
+	switch (MAJOR(dev)) {
+		case 4:
+			return tty_select(MINOR(dev),sel_type,wait);
+		case 5:
+			if (current->tty<0)
+				return 1;
+			return tty_select(current->tty,sel_type,wait);
+		default:
+			return sel_type != SEL_EX;
+	}
 }
@@ -14,40 +14,44 @@
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
-int file_read(struct m_inode * inode, struct file * filp, char * buf, int count)
+/*
+ * file_read() and file_write() work at *pos, which is filp->f_pos for
+ * read/write, and a private copy for pread/pwrite.
+ */
+int file_read(struct m_inode * inode, struct file * filp, off_t * pos,
+	struct uio * uio)
 {
-	int left,chars,nr;
+	int count,left,chars,nr;
 	struct buffer_head * bh;
+	static char zeroes[BLOCK_SIZE];
 
-	if ((left=count)<=0)
+	if ((left=count=uio->u_count)<=0)
 		return 0;
 	while (left) {
-		if (nr = bmap(inode,(filp->f_pos)/BLOCK_SIZE)) {
+		if (nr = bmap(inode,(*pos)/BLOCK_SIZE)) {
 			if (!(bh=bread(inode->i_dev,nr)))
 				break;
 		} else
 			bh = NULL;
-		nr = filp->f_pos % BLOCK_SIZE;
+		nr = *pos % BLOCK_SIZE;
 		chars = MIN( BLOCK_SIZE-nr , left );
-		filp->f_pos += chars;
+		*pos += chars;
 		left -= chars;
 		if (bh) {
-			char * p = nr + bh->b_data;
-			while (chars-->0)
-				put_fs_byte(*(p++),buf++);
+			uio_put(uio,nr + bh->b_data,chars);
 			brelse(bh);
-		} else {
-			while (chars-->0)
-				put_fs_byte(0,buf++);
-		}
+		} else
+			uio_put(uio,zeroes,chars);
 	}
 	inode->i_atime = CURRENT_TIME;
 	return (count-left)?(count-left):-ERROR;
 }
 
-int file_write(struct m_inode * inode, struct file * filp, char * buf, int count)
+int file_write(struct m_inode * inode, struct file * filp, off_t * ppos,
+	struct uio * uio)
 {
 	off_t pos;
+	int count = uio->u_count;
 	int block,c;
 	struct buffer_head * bh;
 	char * p;
@@ -60,7 +64,7 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 	if (filp->f_flags & O_APPEND)
 		pos = inode->i_size;
 	else
-		pos = filp->f_pos;
+		pos = *ppos;
 	while (i<count) {
 		if (!(block = create_block(inode,pos/BLOCK_SIZE)))
 			break;
@@ -77,13 +81,19 @@ int file_write(struct m_inode * inode, struct file * filp, char * buf, int count
 			inode->i_dirt = 1;
 		}
 		i += c;
-		while (c-->0)
-			*(p++) = get_fs_byte(buf++);
+		uio_get(uio,p,c);
 		brelse(bh);
 	}
+/*
+ * Drop any cached text pages only now: the loop above may sleep, and an
+ * exec meanwhile could cache a page we were about to overwrite. Don't
+ * go by the x bits, they may be turned on again later.
+ */
+	if (i)
+		invalidate_inode_pages(inode->i_dev,inode->i_num);
 	inode->i_mtime = CURRENT_TIME;
 	if (!(filp->f_flags & O_APPEND)) {
-		filp->f_pos = pos;
+		*ppos = pos;
 		inode->i_ctime = CURRENT_TIME;
 	}
 	return (i?i:-1);
@@ -4,6 +4,46 @@
  *  (C) 1991  Linus Torvalds
  */
 
+/*
+ * File structures come from a slab cache, instead of a table that has
+ * to be searched for a free entry: get_empty_filp() hands out one with
+ * f_count 1, and put_filp() gives it back when the count drops to 0.
+ * There are still never more than NR_FILE of them.
+ */
+
 #include <linux/fs.h>
+#include <linux/kernel.h>
+
+static struct kmem_cache * filp_cache = NULL;
+static int nr_files = 0;
+
+void file_table_init(void)
+{
+	if (!(filp_cache = kmem_cache_create("filp",sizeof(struct file),NULL)))
+		panic("Unable to create filp cache");
+}
+
+struct file * get_empty_filp(void)
+{
+	struct file * f;
+
+	if (nr_files >= NR_FILE)
+		return NULL;
+	nr_files++;
+	if (!(f = (struct file *) kmem_cache_alloc(filp_cache))) {
+		nr_files--;
+		return NULL;
+	}
+	f->f_mode = f->f_flags = 0;
+	f->f_count = 1;
+	f->f_inode = NULL;
+	f->f_pos = 0;
+	return f;
+}
 
-struct file file_table[NR_FILE];
+void put_filp(struct file * f)
+{
+	f->f_count = 0;
+	kmem_cache_free(filp_cache,f);
+	nr_files--;
+}
@@ -29,7 +29,7 @@ static inline void lock_inode(struct m_inode * inode) //给inode上锁
 {
 	cli();
 	while (inode->i_lock)
-		sleep_on(&inode->i_wait);
+		sleep_on_exclusive(&inode->i_wait);
 	inode->i_lock=1;
 	sti();
 }
@@ -37,7 +37,7 @@ static inline void lock_inode(struct m_inode * inode) //给inode上锁
 static inline void unlock_inode(struct m_inode * inode) //解锁inode
 {
 	inode->i_lock=0;
-	wake_up(&inode->i_wait);
+	wake_up_one(&inode->i_wait);
 }
 
 void invalidate_inodes(int dev) //释放所有inode节点
@@ -54,6 +54,7 @@ void invalidate_inodes(int dev) //释放所有inode节点
 			inode->i_dev = inode->i_dirt = 0;
 		}
 	}
+	invalidate_dev_pages(dev);
 }
 
 void sync_inodes(void) //inode节点同步
@@ -174,6 +175,12 @@ void iput(struct m_inode * inode) //释放inode节点 就是将iNode节点中的
 		inode->i_count--;
 		return;
 	}
+/* proc inodes aren't worth keeping: they'd only go stale */
+	if (IS_PROC(inode)) {
+		if (!--inode->i_count)
+			inode->i_dev = inode->i_dirt = 0;
+		return;
+	}
 	if (S_ISBLK(inode->i_mode)) { //如果此文件是一个块设备的情况下
 		sync_dev(inode->i_zone[0]);  //进行设备的同步
 		wait_on_inode(inode);
@@ -310,6 +317,11 @@ static void read_inode(struct m_inode * inode) //这里面的inode节点应该
 	int block;
 
 	lock_inode(inode);
+	if (IS_PROC(inode)) {
+		proc_read_inode(inode);
+		unlock_inode(inode);
+		return;
+	}
 	if (!(sb=get_super(inode->i_dev))) //获取超级块信息
 		panic("trying to read inode without dev");
 	block = 2 + sb->s_imap_blocks + sb->s_zmap_blocks +
@@ -330,6 +342,8 @@ static void write_inode(struct m_inode * inode) //写inode 传入的参数为ino
 	int block;
 
 	lock_inode(inode);
+	if (IS_PROC(inode))
+		inode->i_dirt = 0;
 	if (!inode->i_dirt || !inode->i_dev) { //如果此inode被清空了，解锁返回
 		unlock_inode(inode);
 		return;
@@ -46,6 +46,9 @@ static int permission(struct m_inode * inode,int mask) //检测想要的访问
 /* special case: not even root can read/write a deleted file */
 	if (inode->i_dev && !inode->i_nlinks) //判断此inode节点是否有效
 		return 0;
+/* nor write to the proc filesystem */
+	if (IS_PROC(inode) && (mask & MAY_WRITE))
+		return 0;
 	else if (current->euid==inode->i_uid) //此时程序与i节点用户相同，取用户权限, 右移6位
 		mode >>= 6;
 	else if (current->egid==inode->i_gid) //此时程序与i节点用户组相同，取用户组权限，右移3位
@@ -165,6 +168,27 @@ static struct buffer_head * find_entry(struct m_inode ** dir,
 	return NULL;
 }
 
+/*
+ *	lookup()
+ *
+ * returns the inode number of 'name' in 'dir', or 0 if it isn't there.
+ * Like find_entry() it may exchange 'dir' when going up over a mount
+ * point. Proc directories have no blocks: their entries are made up by
+ * proc_lookup().
+ */
+static int lookup(struct m_inode ** dir, const char * name, int namelen)
+{
+	struct buffer_head * bh;
+	struct dir_entry * de;
+	int inr;
+
+	if (!(bh = find_entry(dir,name,namelen,&de)))
+		return IS_PROC(*dir) ? proc_lookup(*dir,name,namelen) : 0;
+	inr = de->inode;
+	brelse(bh);
+	return inr;
+}
+
 /*
  *	add_entry()
  *
@@ -243,9 +267,7 @@ static struct m_inode * get_dir(const char * pathname)
 	char c;
 	const char * thisname;
 	struct m_inode * inode;
-	struct buffer_head * bh;
 	int namelen,inr,idev;
-	struct dir_entry * de;
 
 	if (!current->root || !current->root->i_count)
 		panic("No root inode");
@@ -269,13 +291,11 @@ static struct m_inode * get_dir(const char * pathname)
 			/* nothing */ ;
 		if (!c)
 			return inode;
-		if (!(bh = find_entry(&inode,thisname,namelen,&de))) {
+		if (!(inr = lookup(&inode,thisname,namelen))) {
 			iput(inode);
 			return NULL;
 		}
-		inr = de->inode;
 		idev = inode->i_dev;
-		brelse(bh);
 		iput(inode);
 		if (!(inode = iget(idev,inr)))
 			return NULL;
@@ -318,21 +338,16 @@ struct m_inode * namei(const char * pathname)
 	const char * basename;
 	int inr,dev,namelen;
 	struct m_inode * dir;
-	struct buffer_head * bh;
-	struct dir_entry * de;
 
 	if (!(dir = dir_namei(pathname,&namelen,&basename)))
 		return NULL;
 	if (!namelen)			/* special case: '/usr/' etc */
 		return dir;
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
+	if (!(inr = lookup(&dir,basename,namelen))) {
 		iput(dir);
 		return NULL;
 	}
-	inr = de->inode;
 	dev = dir->i_dev;
-	brelse(bh);
 	iput(dir);
 	dir=iget(dev,inr);
 	if (dir) {
@@ -370,8 +385,7 @@ int open_namei(const char * pathname, int flag, int mode,
 		iput(dir);
 		return -EISDIR;
 	}
-	bh = find_entry(&dir,basename,namelen,&de);
-	if (!bh) {
+	if (!(inr = lookup(&dir,basename,namelen))) {
 		if (!(flag & O_CREAT)) {
 			iput(dir);
 			return -ENOENT;
@@ -402,9 +416,7 @@ int open_namei(const char * pathname, int flag, int mode,
 		*res_inode = inode;
 		return 0;
 	}
-	inr = de->inode;
 	dev = dir->i_dev;
-	brelse(bh);
 	iput(dir);
 	if (flag & O_EXCL)
 		return -EEXIST;
@@ -148,15 +148,12 @@ int sys_open(const char * filename,int flag,int mode)
 	if (fd>=NR_OPEN)
 		return -EINVAL;
 	current->close_on_exec &= ~(1<<fd);
-	f=0+file_table;
-	for (i=0 ; i<NR_FILE ; i++,f++)
-		if (!f->f_count) break;
-	if (i>=NR_FILE)
+	if (!(f=get_empty_filp()))
 		return -EINVAL;
-	(current->filp[fd]=f)->f_count++;
+	current->filp[fd]=f;
 	if ((i=open_namei(filename,flag,mode,&inode))<0) {
 		current->filp[fd]=NULL;
-		f->f_count=0;
+		put_filp(f);
 		return i;
 	}
 /* ttys are somewhat special (ttyxx major==4, tty major==5) */
@@ -170,7 +167,7 @@ int sys_open(const char * filename,int flag,int mode)
 			if (current->tty<0) {
 				iput(inode);
 				current->filp[fd]=NULL;
-				f->f_count=0;
+				put_filp(f);
 				return -EPERM;
 			}
 /* Likewise with block-devices: check for floppy_change */
@@ -204,5 +201,6 @@ int sys_close(unsigned int fd)
 	if (--filp->f_count)
 		return (0);
 	iput(filp->f_inode);
+	put_filp(filp);
 	return (0);
 }
@@ -5,20 +5,30 @@
  */
 
 #include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
 
 #include <linux/sched.h>
 #include <linux/mm.h>	/* for get_free_page */
 #include <asm/segment.h>
 
-int read_pipe(struct m_inode * inode, char * buf, int count)
+/*
+ * With O_NONBLOCK, an empty pipe (that still has a writer) or a full
+ * one (that still has a reader) gives -EAGAIN instead of sleeping,
+ * unless something has been transferred already.
+ */
+int read_pipe(struct m_inode * inode, struct file * filp, struct uio * uio)
 {
 	int chars, size, read = 0;
+	int count = uio->u_count;
 
 	while (count>0) {
 		while (!(size=PIPE_SIZE(*inode))) {
 			wake_up(&inode->i_wait);
 			if (inode->i_count != 2) /* are there any writers? */
 				return read;
+			if (filp->f_flags & O_NONBLOCK)
+				return read?read:-EAGAIN;
 			sleep_on(&inode->i_wait);
 		}
 		chars = PAGE_SIZE-PIPE_TAIL(*inode);
@@ -31,16 +41,16 @@ int read_pipe(struct m_inode * inode, char * buf, int count)
 		size = PIPE_TAIL(*inode);
 		PIPE_TAIL(*inode) += chars;
 		PIPE_TAIL(*inode) &= (PAGE_SIZE-1);
-		while (chars-->0)
-			put_fs_byte(((char *)inode->i_size)[size++],buf++);
+		uio_put(uio,size + (char *) inode->i_size,chars);
 	}
 	wake_up(&inode->i_wait);
 	return read;
 }
 	
-int write_pipe(struct m_inode * inode, char * buf, int count)
+int write_pipe(struct m_inode * inode, struct file * filp, struct uio * uio)
 {
 	int chars, size, written = 0;
+	int count = uio->u_count;
 
 	while (count>0) {
 		while (!(size=(PAGE_SIZE-1)-PIPE_SIZE(*inode))) {
@@ -49,6 +59,8 @@ int write_pipe(struct m_inode * inode, char * buf, int count)
 				current->signal |= (1<<(SIGPIPE-1));
 				return written?written:-1;
 			}
+			if (filp->f_flags & O_NONBLOCK)
+				return written?written:-EAGAIN;
 			sleep_on(&inode->i_wait);
 		}
 		chars = PAGE_SIZE-PIPE_HEAD(*inode);
@@ -61,13 +73,35 @@ int write_pipe(struct m_inode * inode, char * buf, int count)
 		size = PIPE_HEAD(*inode);
 		PIPE_HEAD(*inode) += chars;
 		PIPE_HEAD(*inode) &= (PAGE_SIZE-1);
-		while (chars-->0)
-			((char *)inode->i_size)[size++]=get_fs_byte(buf++);
+		uio_get(uio,size + (char *) inode->i_size,chars);
 	}
 	wake_up(&inode->i_wait);
 	return written;
 }
 
+/*
+ * A pipe is readable when there is data or no writer (read returns 0),
+ * and writable when there is room or no reader (write fails at once).
+ */
+int pipe_select(struct m_inode * inode, struct file * filp, int sel_type,
+	select_table * wait)
+{
+	switch (sel_type) {
+		case SEL_IN:
+			if (PIPE_SIZE(*inode) || inode->i_count != 2)
+				return 1;
+			break;
+		case SEL_OUT:
+			if (PIPE_SIZE(*inode) < PAGE_SIZE-1 || inode->i_count != 2)
+				return 1;
+			break;
+		default:
+			return 0;
+	}
+	select_wait(&inode->i_wait,wait);
+	return 0;
+}
+
 int sys_pipe(unsigned long * fildes)
 {
 	struct m_inode * inode;
@@ -75,14 +109,12 @@ int sys_pipe(unsigned long * fildes)
 	int fd[2];
 	int i,j;
 
-	j=0;
-	for(i=0;j<2 && i<NR_FILE;i++)
-		if (!file_table[i].f_count)
-			(f[j++]=i+file_table)->f_count++;
-	if (j==1)
-		f[0]->f_count=0;
-	if (j<2)
+	if (!(f[0]=get_empty_filp()))
+		return -1;
+	if (!(f[1]=get_empty_filp())) {
+		put_filp(f[0]);
 		return -1;
+	}
 	j=0;
 	for(i=0;j<2 && i<NR_OPEN;i++)
 		if (!current->filp[i]) {
@@ -92,13 +124,15 @@ int sys_pipe(unsigned long * fildes)
 	if (j==1)
 		current->filp[fd[0]]=NULL;
 	if (j<2) {
-		f[0]->f_count=f[1]->f_count=0;
+		put_filp(f[0]);
+		put_filp(f[1]);
 		return -1;
 	}
 	if (!(inode=get_pipe_inode())) {
 		current->filp[fd[0]] =
 			current->filp[fd[1]] = NULL;
-		f[0]->f_count = f[1]->f_count = 0;
+		put_filp(f[0]);
+		put_filp(f[1]);
 		return -1;
 	}
 	f[0]->f_inode = f[1]->f_inode = inode;
@@ -0,0 +1,290 @@
+/*
+ *  linux/fs/proc.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * proc.c is a filesystem with nothing on disk: it is "device" PROC_DEV
+ * (major 0, minor 1), so it is mounted with
+ *
+ *	mknod /dev/proc b 0 1
+ *	mount /dev/proc /proc
+ *
+ * It has a single directory, holding a few fixed files and a file for
+ * every task, named by its pid. The inodes are made up in
+ * proc_read_inode(), the directory entries in proc_lookup(), and the
+ * contents of a file are put together anew every time it's read, so
+ * they are always current:
+ *
+ *	meminfo		the free page count, and mem_map[] broken down
+ *	buffers		buffer-cache size, hits and misses, dirty and locked
+ *	blkdev		the number of requests queued per block major
+ *	profile		the kernel's eip histogram, see kernel/profile.c
+ *	<pid>		state, scheduling, cpu times and page faults
+ *
+ * The filesystem is read-only: permission() in namei.c refuses to
+ * write anything, and proc inodes are never written back (and not kept
+ * in the inode table when nobody uses them, see iput()).
+ */
+
+#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+
+extern int vsprintf(char * buf, const char * fmt, va_list args);
+extern unsigned long buffer_hits, buffer_misses;
+extern void buffer_stats(int * total, int * used, int * dirty, int * locked);
+extern int blk_queue_depth(int major);
+extern unsigned long * prof_buffer;
+extern unsigned long prof_len;
+
+#define PROC_MEMINFO_INO	2
+#define PROC_BUFFERS_INO	3
+#define PROC_BLKDEV_INO		4
+#define PROC_PROFILE_INO	5
+#define PROC_TASK_INO		0x100	/* + task slot */
+
+/* the pid a task inode was made for: the slot may be reused since */
+#define TASK_PID(inode) \
+	((inode)->i_zone[1] | ((long) (inode)->i_zone[2] << 16))
+
+static int proc_sprintf(char * buf, const char * fmt, ...)
+{
+	va_list args;
+	int i;
+
+	va_start(args, fmt);
+	i = vsprintf(buf,fmt,args);
+	va_end(args);
+	return i;
+}
+
+static int meminfo_fill(char * buf)
+{
+	int i, free = 0, used = 0, shared = 0, reserved = 0;
+
+	for (i=0 ; i<PAGING_PAGES ; i++)
+		if (mem_map[i] == USED)
+			reserved++;
+		else if (!mem_map[i])
+			free++;
+		else if (mem_map[i] == 1)
+			used++;
+		else
+			shared++;
+	return proc_sprintf(buf,"nr_free_pages\t%d\n"
+		"free\t%d\nused\t%d\nshared\t%d\nreserved\t%d\n",
+		nr_free_pages,free,used,shared,reserved);
+}
+
+static int buffers_fill(char * buf)
+{
+	int total, used, dirty, locked;
+
+	buffer_stats(&total,&used,&dirty,&locked);
+	return proc_sprintf(buf,"buffers\t%d\nused\t%d\ndirty\t%d\n"
+		"locked\t%d\nhits\t%u\nmisses\t%u\n",
+		total,used,dirty,locked,buffer_hits,buffer_misses);
+}
+
+static int blkdev_fill(char * buf)
+{
+	char * p = buf;
+	int major, n;
+
+	for (major = 1 ; (n = blk_queue_depth(major)) >= 0 ; major++)
+		p += proc_sprintf(p,"%d\t%d\n",major,n);
+	return p - buf;
+}
+
+static struct proc_file {
+	const char * name;
+	int ino;
+	int (*fill)(char * buf);
+} proc_files[] = {
+	{ "meminfo", PROC_MEMINFO_INO, meminfo_fill },
+	{ "buffers", PROC_BUFFERS_INO, buffers_fill },
+	{ "blkdev", PROC_BLKDEV_INO, blkdev_fill },
+	{ "profile", PROC_PROFILE_INO, NULL },
+	{ NULL, 0, NULL }
+};
+
+/*
+ * profile is prof_buffer as it is (empty if the kernel isn't profiled):
+ * it doesn't fit in a page like the others.
+ */
+static int profile_read(off_t * pos, struct uio * uio)
+{
+	int len = prof_len * sizeof(unsigned long);
+	int chars;
+
+	if (!prof_buffer || *pos >= len)
+		return 0;
+	chars = len - *pos;
+	if (chars > uio->u_count)
+		chars = uio->u_count;
+	uio_put(uio,(char *) prof_buffer + *pos,chars);
+	*pos += chars;
+	return chars;
+}
+
+static int task_fill(struct m_inode * inode, char * buf)
+{
+	struct task_struct * p;
+	int nr = inode->i_num - PROC_TASK_INO;
+
+	if (nr >= NR_TASKS || !(p = task[nr]) || p->pid != TASK_PID(inode))
+		return 0;
+	return proc_sprintf(buf,"pid\t%d\nppid\t%d\nstate\t%d\n"
+		"counter\t%d\npriority\t%d\nutime\t%d\nstime\t%d\n"
+		"cutime\t%d\ncstime\t%d\nstart_time\t%d\n"
+		"min_flt\t%u\nmaj_flt\t%u\n",
+		p->pid,p->father,p->state,p->counter,p->priority,
+		p->utime,p->stime,p->cutime,p->cstime,p->start_time,
+		p->min_flt,p->maj_flt);
+}
+
+static struct dir_entry * add_dir_entry(struct dir_entry * de, int ino,
+	const char * name)
+{
+	int i;
+
+	de->inode = ino;
+	for (i=0 ; i<NAME_LEN ; i++)
+		de->name[i] = *name ? *name++ : 0;
+	return de+1;
+}
+
+static int root_fill(char * buf)
+{
+	struct dir_entry * de = (struct dir_entry *) buf;
+	struct proc_file * f;
+	struct task_struct * p;
+	char name[NAME_LEN+1];
+
+	de = add_dir_entry(de,ROOT_INO,".");
+	de = add_dir_entry(de,ROOT_INO,"..");
+	for (f = proc_files ; f->name ; f++)
+		de = add_dir_entry(de,f->ino,f->name);
+	for_each_task(p) {
+		proc_sprintf(name,"%d",p->pid);
+		de = add_dir_entry(de,PROC_TASK_INO+p->nr,name);
+	}
+	return (char *) de - buf;
+}
+
+void proc_read_super(struct super_block * s)
+{
+	int i;
+
+	memset(s,0,sizeof(struct d_super_block));
+	for (i=0 ; i<I_MAP_SLOTS ; i++)
+		s->s_imap[i] = NULL;
+	for (i=0 ; i<Z_MAP_SLOTS ; i++)
+		s->s_zmap[i] = NULL;
+	s->s_rd_only = 1;
+}
+
+void proc_read_inode(struct m_inode * inode)
+{
+	struct task_struct * p;
+	int nr;
+
+	inode->i_uid = inode->i_gid = 0;
+	inode->i_size = 0;
+	inode->i_mtime = inode->i_atime = inode->i_ctime = CURRENT_TIME;
+	memset(inode->i_zone,0,sizeof(inode->i_zone));
+	if (inode->i_num == ROOT_INO) {
+		inode->i_mode = S_IFDIR | 0555;
+		inode->i_nlinks = 2;
+		return;
+	}
+	inode->i_mode = S_IFREG | 0444;
+	inode->i_nlinks = 1;
+	if (inode->i_num == PROC_PROFILE_INO && prof_buffer)
+		inode->i_size = prof_len * sizeof(unsigned long);
+	if (inode->i_num < PROC_TASK_INO)
+		return;
+	nr = inode->i_num - PROC_TASK_INO;
+	if (nr < NR_TASKS && (p = task[nr]) != NULL) {
+		inode->i_uid = p->euid;
+		inode->i_gid = p->egid;
+		inode->i_zone[1] = p->pid;
+		inode->i_zone[2] = p->pid >> 16;
+	} else
+		inode->i_zone[1] = inode->i_zone[2] = 0xffff;
+}
+
+/*
+ * proc_lookup() is namei's find_entry() for proc directories: 'name' is
+ * in user space. It returns the inode number, or 0 if there is no such
+ * file.
+ */
+int proc_lookup(struct m_inode * dir, const char * name, int namelen)
+{
+	char buf[NAME_LEN+1];
+	struct proc_file * f;
+	struct task_struct * p;
+	long pid;
+	int i;
+
+	if (dir->i_num != ROOT_INO || !namelen || namelen > NAME_LEN)
+		return 0;
+	for (i=0 ; i<namelen ; i++)
+		buf[i] = get_fs_byte(name+i);
+	buf[namelen] = 0;
+	if (!strcmp(buf,".") || !strcmp(buf,".."))
+		return ROOT_INO;
+	for (f = proc_files ; f->name ; f++)
+		if (!strcmp(buf,f->name))
+			return f->ino;
+	for (pid = 0, i = 0 ; i < namelen ; i++) {
+		if (buf[i] < '0' || buf[i] > '9')
+			return 0;
+		pid = pid*10 + buf[i]-'0';
+	}
+	if (!(p = find_task_by_pid(pid)) || !p->nr)
+		return 0;
+	return PROC_TASK_INO + p->nr;
+}
+
+int proc_read(struct m_inode * inode, off_t * pos, struct uio * uio)
+{
+	struct proc_file * f;
+	char * page;
+	int len, chars;
+
+	if (inode->i_num == PROC_PROFILE_INO)
+		return profile_read(pos,uio);
+	if (!(page = (char *) get_free_page()))
+		return -ENOMEM;
+	if (inode->i_num == ROOT_INO)
+		len = root_fill(page);
+	else if (inode->i_num >= PROC_TASK_INO)
+		len = task_fill(inode,page);
+	else {
+		len = 0;
+		for (f = proc_files ; f->name ; f++)
+			if (f->ino == inode->i_num) {
+				len = f->fill(page);
+				break;
+			}
+	}
+	chars = 0;
+	if (*pos < len) {
+		chars = len - *pos;
+		if (chars > uio->u_count)
+			chars = uio->u_count;
+		uio_put(uio,page + *pos,chars);
+		*pos += chars;
+	}
+	free_page((unsigned long) page);
+	return chars;
+}
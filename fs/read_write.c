@@ -12,15 +12,18 @@
 #include <linux/sched.h>
 #include <asm/segment.h>
 
-extern int rw_char(int rw,int dev, char * buf, int count, off_t * pos);
-extern int read_pipe(struct m_inode * inode, char * buf, int count);
-extern int write_pipe(struct m_inode * inode, char * buf, int count);
-extern int block_read(int dev, off_t * pos, char * buf, int count);
-extern int block_write(int dev, off_t * pos, char * buf, int count);
+extern int rw_char(int rw,int dev, char * buf, int count, off_t * pos,
+		int flags);
+extern int read_pipe(struct m_inode * inode, struct file * filp,
+		struct uio * uio);
+extern int write_pipe(struct m_inode * inode, struct file * filp,
+		struct uio * uio);
+extern int block_read(int dev, off_t * pos, struct uio * uio);
+extern int block_write(int dev, off_t * pos, struct uio * uio);
 extern int file_read(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
+		off_t * pos, struct uio * uio);
 extern int file_write(struct m_inode * inode, struct file * filp,
-		char * buf, int count);
+		off_t * pos, struct uio * uio);
 
 int sys_lseek(unsigned int fd,off_t offset, int origin)
 {
@@ -28,7 +31,8 @@ int sys_lseek(unsigned int fd,off_t offset, int origin)
 	int tmp;
 
 	if (fd >= NR_OPEN || !(file=current->filp[fd]) || !(file->f_inode)
-	   || !IS_SEEKABLE(MAJOR(file->f_inode->i_dev)))
+	   || !(IS_SEEKABLE(MAJOR(file->f_inode->i_dev)) ||
+	   IS_PROC(file->f_inode)))
 		return -EBADF;
 	if (file->f_inode->i_pipe)
 		return -ESPIPE;
@@ -52,52 +56,272 @@ int sys_lseek(unsigned int fd,off_t offset, int origin)
 	return file->f_pos;
 }
 
-int sys_read(unsigned int fd,char * buf,int count)
+/*
+ * Copy n bytes out to the user buffers of a uio. The caller makes sure
+ * there is room: n is never more than uio->u_count.
+ */
+void uio_put(struct uio * uio, char * from, int n)
 {
-	struct file * file;
-	struct m_inode * inode;
+	struct iovec * iov;
+	char * buf;
+	int chars;
+
+	uio->u_count -= n;
+	while (n > 0) {
+		iov = uio->u_iov;
+		if (!iov->iov_len) {
+			uio->u_iov++;
+			uio->u_nr--;
+			continue;
+		}
+		chars = (n < (int) iov->iov_len) ? n : iov->iov_len;
+		buf = (char *) iov->iov_base;
+		iov->iov_base = buf + chars;
+		iov->iov_len -= chars;
+		n -= chars;
+		while (chars-->0)
+			put_fs_byte(*(from++),buf++);
+	}
+}
+
+void uio_get(struct uio * uio, char * to, int n)
+{
+	struct iovec * iov;
+	char * buf;
+	int chars;
+
+	uio->u_count -= n;
+	while (n > 0) {
+		iov = uio->u_iov;
+		if (!iov->iov_len) {
+			uio->u_iov++;
+			uio->u_nr--;
+			continue;
+		}
+		chars = (n < (int) iov->iov_len) ? n : iov->iov_len;
+		buf = (char *) iov->iov_base;
+		iov->iov_base = buf + chars;
+		iov->iov_len -= chars;
+		n -= chars;
+		while (chars-->0)
+			*(to++) = get_fs_byte(buf++);
+	}
+}
+
+/*
+ * Character devices don't know about iovecs: they get the segments one
+ * at a time, and we stop at the first short transfer (a tty read that
+ * ran out of input, say).
+ */
+static int rw_char_uio(int rw, int dev, struct uio * uio, off_t * pos,
+	int flags)
+{
+	struct iovec * iov;
+	int done = 0, res;
+
+	for (iov = uio->u_iov ; uio->u_nr > 0 ; iov++, uio->u_nr--) {
+		if (!iov->iov_len)
+			continue;
+		res = rw_char(rw,dev,(char *) iov->iov_base,iov->iov_len,pos,
+			flags);
+		if (res < 0)
+			return done?done:res;
+		done += res;
+		if (res < (int) iov->iov_len)
+			break;
+	}
+	return done;
+}
+
+/*
+ * do_read() and do_write() transfer at *pos: that's &file->f_pos,
+ * except for pread/pwrite, which leave f_pos alone (and for which
+ * pipes have been weeded out already).
+ */
+static int do_read(struct file * file, off_t * pos, struct uio * uio)
+{
+	struct m_inode * inode = file->f_inode;
 
-	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
-		return -EINVAL;
-	if (!count)
-		return 0;
-	verify_area(buf,count);
-	inode = file->f_inode;
 	if (inode->i_pipe)
-		return (file->f_mode&1)?read_pipe(inode,buf,count):-EIO;
+		return (file->f_mode&1)?read_pipe(inode,file,uio):-EIO;
+	if (IS_PROC(inode))
+		return proc_read(inode,pos,uio);
 	if (S_ISCHR(inode->i_mode))
-		return rw_char(READ,inode->i_zone[0],buf,count,&file->f_pos);
+		return rw_char_uio(READ,inode->i_zone[0],uio,pos,
+			file->f_flags);
 	if (S_ISBLK(inode->i_mode))
-		return block_read(inode->i_zone[0],&file->f_pos,buf,count);
+		return block_read(inode->i_zone[0],pos,uio);
 	if (S_ISDIR(inode->i_mode) || S_ISREG(inode->i_mode)) {
-		if (count+file->f_pos > inode->i_size)
-			count = inode->i_size - file->f_pos;
-		if (count<=0)
+		if (uio->u_count+*pos > inode->i_size)
+			uio->u_count = inode->i_size - *pos;
+		if (uio->u_count<=0)
 			return 0;
-		return file_read(inode,file,buf,count);
+		return file_read(inode,file,pos,uio);
 	}
 	printk("(Read)inode->i_mode=%06o\n\r",inode->i_mode);
 	return -EINVAL;
 }
 
+static int do_write(struct file * file, off_t * pos, struct uio * uio)
+{
+	struct m_inode * inode = file->f_inode;
+
+	if (inode->i_pipe)
+		return (file->f_mode&2)?write_pipe(inode,file,uio):-EIO;
+	if (S_ISCHR(inode->i_mode))
+		return rw_char_uio(WRITE,inode->i_zone[0],uio,pos,
+			file->f_flags);
+	if (S_ISBLK(inode->i_mode))
+		return block_write(inode->i_zone[0],pos,uio);
+	if (S_ISREG(inode->i_mode))
+		return file_write(inode,file,pos,uio);
+	printk("(Write)inode->i_mode=%06o\n\r",inode->i_mode);
+	return -EINVAL;
+}
+
+int sys_read(unsigned int fd,char * buf,int count)
+{
+	struct file * file;
+	struct iovec iov;
+	struct uio uio;
+
+	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
+		return -EINVAL;
+	if (!count)
+		return 0;
+	verify_area(buf,count);
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	uio.u_iov = &iov;
+	uio.u_nr = 1;
+	uio.u_count = count;
+	return do_read(file,&file->f_pos,&uio);
+}
+
 int sys_write(unsigned int fd,char * buf,int count)
 {
 	struct file * file;
-	struct m_inode * inode;
+	struct iovec iov;
+	struct uio uio;
 	
 	if (fd>=NR_OPEN || count <0 || !(file=current->filp[fd]))
 		return -EINVAL;
 	if (!count)
 		return 0;
-	inode=file->f_inode;
-	if (inode->i_pipe)
-		return (file->f_mode&2)?write_pipe(inode,buf,count):-EIO;
-	if (S_ISCHR(inode->i_mode))
-		return rw_char(WRITE,inode->i_zone[0],buf,count,&file->f_pos);
-	if (S_ISBLK(inode->i_mode))
-		return block_write(inode->i_zone[0],&file->f_pos,buf,count);
-	if (S_ISREG(inode->i_mode))
-		return file_write(inode,file,buf,count);
-	printk("(Write)inode->i_mode=%06o\n\r",inode->i_mode);
-	return -EINVAL;
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	uio.u_iov = &iov;
+	uio.u_nr = 1;
+	uio.u_count = count;
+	return do_write(file,&file->f_pos,&uio);
+}
+
+/*
+ * pread() and pwrite() work at the given offset, and don't touch (or
+ * get confused by) the f_pos that is shared with other users of the
+ * file. They take four arguments, so they are SC_6ARGS calls.
+ */
+int sys_pread(unsigned int fd, char * buf, int count, off_t offset)
+{
+	struct file * file;
+	struct iovec iov;
+	struct uio uio;
+
+	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
+		return -EINVAL;
+	if (file->f_inode->i_pipe)
+		return -ESPIPE;
+	if (offset < 0)
+		return -EINVAL;
+	if (!count)
+		return 0;
+	verify_area(buf,count);
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	uio.u_iov = &iov;
+	uio.u_nr = 1;
+	uio.u_count = count;
+	return do_read(file,&offset,&uio);
+}
+
+int sys_pwrite(unsigned int fd, char * buf, int count, off_t offset)
+{
+	struct file * file;
+	struct iovec iov;
+	struct uio uio;
+
+	if (fd>=NR_OPEN || count<0 || !(file=current->filp[fd]))
+		return -EINVAL;
+	if (file->f_inode->i_pipe)
+		return -ESPIPE;
+	if (offset < 0)
+		return -EINVAL;
+	if (!count)
+		return 0;
+	iov.iov_base = buf;
+	iov.iov_len = count;
+	uio.u_iov = &iov;
+	uio.u_nr = 1;
+	uio.u_count = count;
+	return do_write(file,&offset,&uio);
+}
+
+/*
+ * Copy the iovec array of a readv/writev into the kernel, and add up
+ * the lengths. Returns the total, or an error.
+ */
+static int get_iovec(struct iovec * iov, const struct iovec * uiov, int nr,
+	int rw)
+{
+	int i, count = 0;
+
+	if (nr <= 0 || nr > UIO_MAXIOV)
+		return -EINVAL;
+	for (i = 0 ; i < nr ; i++) {
+		iov[i].iov_base = (void *) get_fs_long((unsigned long *)
+			&uiov[i].iov_base);
+		iov[i].iov_len = get_fs_long((unsigned long *)
+			&uiov[i].iov_len);
+		if ((int) iov[i].iov_len < 0 ||
+		    count + (int) iov[i].iov_len < count)
+			return -EINVAL;
+		count += iov[i].iov_len;
+		if (rw == READ && iov[i].iov_len)
+			verify_area(iov[i].iov_base,iov[i].iov_len);
+	}
+	return count;
+}
+
+int sys_readv(unsigned int fd, const struct iovec * vector, int nr)
+{
+	struct iovec iov[UIO_MAXIOV];
+	struct file * file;
+	struct uio uio;
+	int count;
+
+	if (fd>=NR_OPEN || !(file=current->filp[fd]))
+		return -EINVAL;
+	if ((count = get_iovec(iov,vector,nr,READ)) <= 0)
+		return count;
+	uio.u_iov = iov;
+	uio.u_nr = nr;
+	uio.u_count = count;
+	return do_read(file,&file->f_pos,&uio);
+}
+
+int sys_writev(unsigned int fd, const struct iovec * vector, int nr)
+{
+	struct iovec iov[UIO_MAXIOV];
+	struct file * file;
+	struct uio uio;
+	int count;
+
+	if (fd>=NR_OPEN || !(file=current->filp[fd]))
+		return -EINVAL;
+	if ((count = get_iovec(iov,vector,nr,WRITE)) <= 0)
+		return count;
+	uio.u_iov = iov;
+	uio.u_nr = nr;
+	uio.u_count = count;
+	return do_write(file,&file->f_pos,&uio);
 }
@@ -0,0 +1,211 @@
+/*
+ *  linux/fs/select.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * select() and poll() wait for any of a number of descriptors to become
+ * ready. Both are turned into an array of pollfds, and do_poll() looks
+ * at all of them with the task already marked TASK_INTERRUPTIBLE. The
+ * first time round every file that isn't ready puts us on its wait
+ * queue: a wake_up() on any of them (or the timeout, or a signal) makes
+ * us runnable again, and we simply look again. A wake-up that comes in
+ * between looking and calling schedule() just sets us running, so it
+ * can't get lost.
+ *
+ * Pipes and ttys know when they are ready (pipe_select, tty_select);
+ * regular files, directories and block devices never make a reader or
+ * writer wait for long, so they are always ready.
+ */
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/select.h>
+#include <sys/poll.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+
+extern int pipe_select(struct m_inode * inode, struct file * filp,
+	int sel_type, select_table * wait);
+extern int char_select(int dev, int sel_type, select_table * wait);
+
+static int file_select(struct file * file, int sel_type, select_table * wait)
+{
+	struct m_inode * inode = file->f_inode;
+
+	if (inode->i_pipe)
+		return pipe_select(inode,file,sel_type,wait);
+	if (S_ISCHR(inode->i_mode))
+		return char_select(inode->i_zone[0],sel_type,wait);
+	return sel_type != SEL_EX;
+}
+
+static int fd_poll(struct pollfd * p, select_table * wait)
+{
+	struct file * file;
+	int mask = 0;
+
+	if (p->fd < 0)
+		return 0;
+	if (p->fd >= NR_OPEN || !(file = current->filp[p->fd]))
+		return POLLNVAL;
+	if ((p->events & POLLIN) && file_select(file,SEL_IN,wait))
+		mask |= POLLIN;
+	if ((p->events & POLLOUT) && file_select(file,SEL_OUT,wait))
+		mask |= POLLOUT;
+	if ((p->events & POLLPRI) && file_select(file,SEL_EX,wait))
+		mask |= POLLPRI;
+	return mask;
+}
+
+/*
+ * 'timeout' is in ticks: 0 means don't wait at all, -1 wait for ever.
+ * On return, 'timeout' holds what's left of it.
+ */
+static int do_poll(struct pollfd * fds, int nfds, long * timeout)
+{
+	select_table wait_table, * wait = NULL;
+	struct timer_list timer;
+	struct pollfd * p;
+	int count;
+
+	wait_table.nr = 0;
+	wait_table.entry = NULL;
+	timer.next = timer.prev = NULL;
+	if (*timeout) {
+		wait_table.entry = (struct select_table_entry *) get_free_page();
+		if (!wait_table.entry)
+			return -ENOMEM;
+		wait = &wait_table;
+	}
+	if (*timeout > 0) {
+		timer.expires = jiffies + *timeout;
+		timer.data = (unsigned long) current;
+		timer.function = process_timeout;
+		add_timer(&timer);
+	}
+	for (;;) {
+		current->state = TASK_INTERRUPTIBLE;
+		count = 0;
+		for (p = fds ; p < fds+nfds ; p++)
+			if ((p->revents = fd_poll(p,wait)) != 0)
+				count++;
+		wait = NULL;
+		if (count || !*timeout || (current->signal & ~current->blocked))
+			break;
+		if (*timeout > 0 && !timer_pending(&timer))
+			break;
+		schedule();
+	}
+	current->state = TASK_RUNNING;
+	if (*timeout > 0) {
+		del_timer(&timer);
+		*timeout = timer.expires - jiffies;
+		if (*timeout < 0)
+			*timeout = 0;
+	}
+	if (wait_table.entry) {
+		free_wait(&wait_table);
+		free_page((unsigned long) wait_table.entry);
+	}
+	if (!count && (current->signal & ~current->blocked))
+		return -EINTR;
+	return count;
+}
+
+int sys_select(int n, fd_set * inp, fd_set * outp, fd_set * exp,
+	struct timeval * tvp)
+{
+	struct pollfd fds[NR_OPEN];
+	fd_set in, out, ex, res_in, res_out, res_ex;
+	long timeout = -1;
+	int i, nfds, count;
+
+	if (n < 0)
+		return -EINVAL;
+	if (n > NR_OPEN)
+		n = NR_OPEN;
+	in = inp ? get_fs_long(inp) : 0;
+	out = outp ? get_fs_long(outp) : 0;
+	ex = exp ? get_fs_long(exp) : 0;
+	if (tvp) {
+		timeout = get_fs_long((unsigned long *) &tvp->tv_sec);
+		i = get_fs_long((unsigned long *) &tvp->tv_usec);
+		if (timeout < 0 || i < 0)
+			return -EINVAL;
+		timeout = timeout*HZ + (i + 1000000/HZ - 1) / (1000000/HZ);
+	}
+	for (nfds = i = 0 ; i < n ; i++) {
+		fds[nfds].events = 0;
+		if (FD_ISSET(i,&in))
+			fds[nfds].events |= POLLIN;
+		if (FD_ISSET(i,&out))
+			fds[nfds].events |= POLLOUT;
+		if (FD_ISSET(i,&ex))
+			fds[nfds].events |= POLLPRI;
+		if (!fds[nfds].events)
+			continue;
+		if (!current->filp[i])
+			return -EBADF;
+		fds[nfds++].fd = i;
+	}
+	if ((count = do_poll(fds,nfds,&timeout)) < 0)
+		return count;
+	res_in = res_out = res_ex = 0;
+	for (i = 0 ; i < nfds ; i++) {
+		if (fds[i].revents & POLLIN)
+			FD_SET(fds[i].fd,&res_in);
+		if (fds[i].revents & POLLOUT)
+			FD_SET(fds[i].fd,&res_out);
+		if (fds[i].revents & POLLPRI)
+			FD_SET(fds[i].fd,&res_ex);
+	}
+	if (inp) {
+		verify_area(inp,sizeof(fd_set));
+		put_fs_long(res_in,inp);
+	}
+	if (outp) {
+		verify_area(outp,sizeof(fd_set));
+		put_fs_long(res_out,outp);
+	}
+	if (exp) {
+		verify_area(exp,sizeof(fd_set));
+		put_fs_long(res_ex,exp);
+	}
+	if (tvp) {
+		verify_area(tvp,sizeof(struct timeval));
+		put_fs_long(timeout/HZ,(unsigned long *) &tvp->tv_sec);
+		put_fs_long((timeout%HZ)*(1000000/HZ),
+			(unsigned long *) &tvp->tv_usec);
+	}
+	return count;
+}
+
+int sys_poll(struct pollfd * ufds, unsigned long nfds, int msecs)
+{
+	struct pollfd fds[NR_OPEN];
+	long timeout;
+	int i, count;
+
+	if (nfds > NR_OPEN)
+		return -EINVAL;
+	for (i = 0 ; i < nfds ; i++) {
+		fds[i].fd = get_fs_long((unsigned long *) &ufds[i].fd);
+		fds[i].events = get_fs_word((unsigned short *) &ufds[i].events);
+	}
+	if (msecs < 0)
+		timeout = -1;
+	else
+		timeout = (msecs + 1000/HZ - 1) / (1000/HZ);
+	if ((count = do_poll(fds,nfds,&timeout)) < 0)
+		return count;
+	verify_area(ufds,nfds*sizeof(struct pollfd));
+	for (i = 0 ; i < nfds ; i++)
+		put_fs_word(fds[i].revents,&ufds[i].revents);
+	return count;
+}
@@ -32,7 +32,7 @@ static void lock_super(struct super_block * sb) //加锁
 {
 	cli();
 	while (sb->s_lock)
-		sleep_on(&(sb->s_wait));
+		sleep_on_exclusive(&(sb->s_wait));
 	sb->s_lock = 1;
 	sti();
 }
@@ -41,7 +41,7 @@ static void free_super(struct super_block * sb) //解锁，可以改为ulock_sup
 {
 	cli();
 	sb->s_lock = 0;
-	wake_up(&(sb->s_wait));
+	wake_up_one(&(sb->s_wait));
 	sti();
 }
 
@@ -123,6 +123,11 @@ static struct super_block * read_super(int dev) //将磁盘上的超级块信息
 	s->s_rd_only = 0;
 	s->s_dirt = 0;
 	lock_super(s); //锁定超级块数组
+	if (dev == PROC_DEV) {
+		proc_read_super(s);
+		free_super(s);
+		return s;
+	}
 	if (!(bh = bread(dev,1))) { //将磁盘中的超级块信息读入到高速缓存区中
 	//没有找到，则清空超级块数组
 		s->s_dev=0;
@@ -199,6 +204,7 @@ int sys_umount(char * dev_name)
 	iput(sb->s_isup);
 	sb->s_isup = NULL;
 	put_super(dev); //释放指定的超级块
+	invalidate_dev_pages(dev);
 	sync_dev(dev); //同步设备
 	return 0;
 }
@@ -255,8 +261,7 @@ void mount_root(void) //根文件系统的挂接，此程序只会执行一次
 
 	if (32 != sizeof (struct d_inode))
 		panic("bad i-node size");
-	for(i=0;i<NR_FILE;i++) //文件表信息初始化
-		file_table[i].f_count=0;
+	file_table_init(); //文件表信息初始化
 		//验证根文件系统是否在软盘上
 	if (MAJOR(ROOT_DEV) == 2) {
 		printk("Insert root floppy and press ENTER");
@@ -15,6 +15,10 @@ __asm__ ("movl %%esp,%%eax\n\t" \
 
 #define sti() __asm__ ("sti"::)
 #define cli() __asm__ ("cli"::)
+#define save_flags(x) \
+__asm__ __volatile__("pushfl ; popl %0":"=r" (x))
+#define restore_flags(x) \
+__asm__ __volatile__("pushl %0 ; popfl"::"r" (x))
 #define nop() __asm__ ("nop"::)
 
 #define iret() __asm__ ("iret"::)
@@ -3,7 +3,7 @@
 
 #include <sys/types.h>
 
-/* open/fcntl - NOCTTY, NDELAY isn't implemented yet */
+/* open/fcntl - NOCTTY isn't implemented yet, NDELAY only for pipes and ttys */
 #define O_ACCMODE	00003
 #define O_RDONLY	   00
 #define O_WRONLY	   01
@@ -13,7 +13,7 @@
 #define O_NOCTTY	00400	/* not fcntl */
 #define O_TRUNC		01000	/* not fcntl */
 #define O_APPEND	02000
-#define O_NONBLOCK	04000	/* not fcntl */
+#define O_NONBLOCK	04000
 #define O_NDELAY	O_NONBLOCK
 
 /* Defines for fcntl-commands. Note that currently
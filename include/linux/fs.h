@@ -7,11 +7,12 @@
 #define _FS_H
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 /* devices are as follows: (same as minix, so we can use the minix
  * file system. These are major numbers.)
  *
- * 0 - unused (nodev)
+ * 0 - unused (nodev), but 0x001 is the proc filesystem
  * 1 - /dev/mem
  * 2 - /dev/fd
  * 3 - /dev/hd
@@ -23,6 +24,9 @@
 
 #define IS_SEEKABLE(x) ((x)>=1 && (x)<=3)
 
+#define PROC_DEV 0x001
+#define IS_PROC(inode) ((inode)->i_dev == PROC_DEV)
+
 #define READ 0
 #define WRITE 1
 #define READA 2		/* read-ahead - don't pause */
@@ -73,11 +77,12 @@ struct buffer_head {
 	unsigned char b_dirt;		/* 0-clean,1-dirty */ //是否占用该块
 	unsigned char b_count;		/* users using this block */  //被进程使用数
 	unsigned char b_lock;		/* 0 - ok, 1 -locked */   //该块是否被锁定(当某进程缓冲区从块设备读取信息时，防止其他进程访问改写此缓冲区)
-	struct task_struct * b_wait; //等待改缓冲区解锁的任务
+	struct wait_queue * b_wait; //等待改缓冲区解锁的任务
 	struct buffer_head * b_prev;
 	struct buffer_head * b_next;
 	struct buffer_head * b_prev_free;
 	struct buffer_head * b_next_free;
+	struct buffer_head * b_this_page;	/* circular list, NULL if static */
 };
 
 struct d_inode {
@@ -100,7 +105,7 @@ struct m_inode {
 	unsigned char i_nlinks; //此文件链接数(硬链接)
 	unsigned short i_zone[9]; //文件对逻辑块的映射数组
 /* these are in memory also */
-	struct task_struct * i_wait; //等待该i节点的进程
+	struct wait_queue * i_wait; //等待该i节点的进程
 	unsigned long i_atime; //最后访问时间
 	unsigned long i_ctime;//i节点自身修改时间
 	unsigned short i_dev; //i节点所在设备号
@@ -138,7 +143,7 @@ struct super_block {          //超级块结构体
 	struct m_inode * s_isup;  //根目录i节点（比此文件系统更大的文件系统挂载的节点）
 	struct m_inode * s_imount; //被安装到的i节点
 	unsigned long s_time; //修改时间
-	struct task_struct * s_wait; //等待该超级块的进程
+	struct wait_queue * s_wait; //等待该超级块的进程
 	unsigned char s_lock; //锁
 	unsigned char s_rd_only; //是否只读
 	unsigned char s_dirt;  //脏标志
@@ -161,7 +166,6 @@ struct dir_entry {
 };
 
 extern struct m_inode inode_table[NR_INODE];
-extern struct file file_table[NR_FILE];
 extern struct super_block super_block[NR_SUPER];
 extern struct buffer_head * start_buffer;
 extern int nr_buffers;
@@ -183,19 +187,45 @@ extern void iput(struct m_inode * inode);
 extern struct m_inode * iget(int dev,int nr);
 extern struct m_inode * get_empty_inode(void);
 extern struct m_inode * get_pipe_inode(void);
+extern void file_table_init(void);
+extern struct file * get_empty_filp(void);
+extern void put_filp(struct file * f);
 extern struct buffer_head * get_hash_table(int dev, int block);
 extern struct buffer_head * getblk(int dev, int block);
 extern void ll_rw_block(int rw, struct buffer_head * bh);
 extern void brelse(struct buffer_head * buf);
 extern struct buffer_head * bread(int dev,int block);
-extern void bread_page(unsigned long addr,int dev,int b[4]);
+extern int bread_page(unsigned long addr,int dev,int b[4]);
+extern void bwrite_page(unsigned long addr,int dev,int b[4]);
+extern int ll_rw_page(int rw, int dev, int nr, char * buffer);
 extern struct buffer_head * breada(int dev,int block,...);
+extern int shrink_buffers(void);
 extern int new_block(int dev);
 extern void free_block(int dev, int block);
 extern struct m_inode * new_inode(int dev);
 extern void free_inode(struct m_inode * inode);
 extern int sync_dev(int dev);
 extern struct super_block * get_super(int dev);
+
+/*
+ * A uio describes the user side of a read or write: the iovecs (copied
+ * into the kernel) still to be filled or emptied, and the number of
+ * bytes left. uio_put() and uio_get() in read_write.c move data to and
+ * from it, stepping over the iovecs as they go.
+ */
+struct uio {
+	struct iovec * u_iov;
+	int u_nr;
+	int u_count;
+};
+
+extern void uio_put(struct uio * uio, char * from, int n);
+extern void uio_get(struct uio * uio, char * to, int n);
+
+extern void proc_read_super(struct super_block * s);
+extern void proc_read_inode(struct m_inode * inode);
+extern int proc_lookup(struct m_inode * dir, const char * name, int namelen);
+extern int proc_read(struct m_inode * inode, off_t * pos, struct uio * uio);
 extern int ROOT_DEV;
 
 extern void mount_root(void);
@@ -0,0 +1,38 @@
+#ifndef _INTERRUPT_H
+#define _INTERRUPT_H
+
+/*
+ * Bottom halves are the part of interrupt handling that doesn't have to
+ * be done right away: the handler just does mark_bh(), and the routine
+ * is called later, with interrupts enabled - on the way back to user
+ * mode (ret_from_sys_call) or from schedule(). A bottom half can't
+ * sleep, and never runs twice at the same time.
+ */
+struct bh_struct {
+	void (*routine)(void *);
+	void * data;
+};
+
+extern unsigned long bh_active;
+extern unsigned long bh_mask;
+extern struct bh_struct bh_base[32];
+
+/* entries in bh_base: lower numbers run first */
+#define TTY_BH		0
+#define CONSOLE_BH	1
+
+static inline void init_bh(int nr, void (*routine)(void *), void * data)
+{
+	bh_base[nr].routine = routine;
+	bh_base[nr].data = data;
+	bh_mask |= 1UL << nr;
+}
+
+static inline void mark_bh(int nr)
+{
+	__asm__ __volatile__("btsl %1,%0":"=m" (bh_active):"ir" (nr));
+}
+
+extern void do_bottom_half(void);
+
+#endif
@@ -5,12 +5,19 @@ void verify_area(void * addr,int count);
 volatile void panic(const char * str);
 int printf(const char * fmt, ...);
 int printk(const char * fmt, ...);
-int tty_write(unsigned ch,char * buf,int count);
+int tty_write(unsigned ch,char * buf,int count,int flags);
 void * malloc(unsigned int size);
 void free_s(void * obj, int size);
 
 #define free(x) free_s((x), 0)
 
+struct kmem_cache;
+struct kmem_cache * kmem_cache_create(const char * name, int size,
+	void (*ctor)(void *));
+void * kmem_cache_alloc(struct kmem_cache * cachep);
+void kmem_cache_free(struct kmem_cache * cachep, void * obj);
+int kmem_cache_shrink(void);
+
 /*
  * This is defined as a macro, but at some point this might become a
  * real subroutine that sets a flag if it returns true (to do
@@ -5,6 +5,40 @@
 
 extern unsigned long get_free_page(void);
 extern unsigned long put_page(unsigned long page,unsigned long address);
+extern unsigned long put_dirty_page(unsigned long page,unsigned long address);
 extern void free_page(unsigned long addr);
 
+/* mm/swap.c */
+extern int swap_out(void);
+extern int swap_in(unsigned long * table_ptr);
+extern void swap_free(int nr);
+
+#define invalidate() \
+__asm__("movl %%eax,%%cr3"::"a" (0))
+
+/* these are not to be changed without changing head.s etc */
+#define LOW_MEM 0x100000
+extern long HIGH_MEMORY;
+#define PAGING_MEMORY (15*1024*1024)
+#define PAGING_PAGES (PAGING_MEMORY>>12)
+#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
+#define USED 100
+
+extern unsigned char mem_map [ PAGING_PAGES ];
+extern int nr_free_pages;
+
+#define PAGE_DIRTY	0x40
+#define PAGE_ACCESSED	0x20
+#define PAGE_USER	0x04
+#define PAGE_RW		0x02
+#define PAGE_PRESENT	0x01
+
+/* mm/page_cache.c */
+extern unsigned long find_cached_page(int dev, int ino, unsigned long offset);
+extern int add_to_page_cache(unsigned long page, int dev, int ino,
+	unsigned long offset);
+extern void invalidate_inode_pages(int dev, int ino);
+extern void invalidate_dev_pages(int dev);
+extern int shrink_page_cache(void);
+
 #endif
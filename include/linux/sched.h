@@ -1,6 +1,12 @@
 #ifndef _SCHED_H
 #define _SCHED_H
 
+/*
+ * Every task has a 64MB slot of linear address space (and a TSS/LDT pair
+ * in the gdt), so there can't be more than 64. Nothing scans task[]
+ * any more though: the tasks are found through the task list, the pid
+ * hash and the child lists below.
+ */
 #define NR_TASKS 64
 #define HZ 100
 
@@ -33,10 +39,26 @@ extern void sched_init(void);
 extern void schedule(void);
 extern void trap_init(void);
 extern void panic(const char * str);
-extern int tty_write(unsigned minor,char * buf,int count);
+extern int tty_write(unsigned minor,char * buf,int count,int flags);
 
 typedef int (*fn_ptr)();
 
+/*
+ * Flags for the system calls, in sys_call_flags[]. SC_FAST calls can't
+ * sleep, touch user memory or send signals: they are called with only
+ * ds set up, and return straight away, without looking for signals or
+ * a reschedule. SC_6ARGS calls get esi, edi and ebp as arguments 4-6.
+ * SC_NOBATCH calls need the real stack frame of system_call, and can't
+ * be done through sys_multicall().
+ */
+#define SC_FAST		1
+#define SC_6ARGS	2
+#define SC_NOBATCH	4
+
+extern fn_ptr sys_call_table[];
+extern unsigned char sys_call_flags[];
+extern int nr_syscalls;
+
 struct i387_struct {
 	long	cwd;
 	long	swd;
@@ -75,6 +97,25 @@ struct tss_struct {
 	struct i387_struct i387;
 };
 
+/*
+ * Timers are kept in a timer wheel (see kernel/sched.c). The caller owns
+ * the timer_list: add_timer() links it in, and it is unlinked again
+ * just before 'function' is called with 'data', from the timer
+ * interrupt. 'expires' is in jiffies.
+ */
+struct timer_list {
+	struct timer_list * next;
+	struct timer_list * prev;
+	unsigned long expires;
+	unsigned long data;
+	void (*function)(unsigned long);
+};
+
+#define timer_pending(t) ((t)->next != NULL)
+
+extern void add_timer(struct timer_list * timer);
+extern int del_timer(struct timer_list * timer);
+
 struct task_struct {
 /* these are hardcoded - don't touch */
 	long state;	/* -1 unrunnable, 0 runnable, >0 stopped */
@@ -87,10 +128,20 @@ struct task_struct {
 	int exit_code;
 	unsigned long start_code,end_code,end_data,brk,start_stack;
 	long pid,father,pgrp,session,leader;
+/* parent, youngest child, younger sibling, older sibling */
+	struct task_struct *p_pptr, *p_cptr, *p_ysptr, *p_osptr;
+	struct task_struct *next_task, *prev_task, *pidhash_next;
+	int nr;			/* slot in task[], gdt */
+/* run queue links: array is NULL unless queued (current never is) */
+	struct task_struct *run_next, *run_prev;
+	struct prio_array * array;
+	long epoch;		/* last counter recalculation seen */
 	unsigned short uid,euid,suid;
 	unsigned short gid,egid,sgid;
-	long alarm;
+	struct timer_list real_timer;	/* alarm() */
 	long utime,stime,cutime,cstime,start_time;
+	unsigned long min_flt,maj_flt;	/* page faults without/with i/o */
+	unsigned long prof_buf,prof_size,prof_off,prof_scale;	/* profil() */
 	unsigned short used_math;
 /* file system info */
 	int tty;		/* -1 if no tty, so it must be signed */
@@ -115,8 +166,13 @@ struct task_struct {
 /* signals */	0,{{},},0, \
 /* ec,brk... */	0,0,0,0,0,0, \
 /* pid etc.. */	0,-1,0,0,0, \
+/* proc links*/	&init_task.task,NULL,NULL,NULL, \
+/* task list */	&init_task.task,&init_task.task,NULL,0, \
+/* run queue */	NULL,NULL,NULL,0, \
 /* uid etc */	0,0,0,0,0,0, \
-/* alarm */	0,0,0,0,0,0, \
+/* alarm */	{NULL,NULL,0,0,NULL},0,0,0,0,0, \
+/* faults */	0,0, \
+/* profil */	0,0,0,0, \
 /* math */	0, \
 /* fs info */	-1,0022,NULL,NULL,NULL,0, \
 /* filp */	{NULL,}, \
@@ -141,10 +197,78 @@ extern long startup_time;
 
 #define CURRENT_TIME (startup_time+jiffies/HZ)
 
-extern void add_timer(long jiffies, void (*fn)(void));
-extern void sleep_on(struct task_struct ** p);
-extern void interruptible_sleep_on(struct task_struct ** p);
-extern void wake_up(struct task_struct ** p);
+/* all tasks but task 0, which is the head of the list */
+#define for_each_task(p) \
+	for (p = FIRST_TASK ; (p = p->next_task) != FIRST_TASK ; )
+
+#define PIDHASH_SZ 64
+#define pid_hashfn(x) ((x) & (PIDHASH_SZ-1))
+
+extern struct task_struct * pidhash[PIDHASH_SZ];
+
+static inline struct task_struct * find_task_by_pid(long pid)
+{
+	struct task_struct * p;
+
+	for (p = pidhash[pid_hashfn(pid)] ; p ; p = p->pidhash_next)
+		if (p->pid == pid)
+			return p;
+	return NULL;
+}
+
+extern int alloc_task_slot(void);
+extern void free_task_slot(int nr);
+extern void link_task(struct task_struct * p);
+extern void unlink_task(struct task_struct * p);
+
+extern void process_timeout(unsigned long data);
+extern void wake_up_process(struct task_struct * p);
+extern void post_signal(struct task_struct * p, long mask);
+/*
+ * A wait queue is a list of wait_queue entries, one for each sleeper,
+ * living on the sleeper's kernel stack. Exclusive waiters are the ones
+ * that are after something only one of them can get (a lock, a free
+ * request): wake_up_one() wakes all the others but only one of those.
+ */
+struct wait_queue {
+	struct task_struct * task;
+	struct wait_queue * next;
+	int exclusive;
+};
+
+extern void sleep_on(struct wait_queue ** p);
+extern void sleep_on_exclusive(struct wait_queue ** p);
+extern void interruptible_sleep_on(struct wait_queue ** p);
+extern void wake_up_one(struct wait_queue ** p);
+extern void wake_up_all(struct wait_queue ** p);
+
+#define wake_up(p) wake_up_all(p)
+
+/*
+ * select() and poll() put the task on the wait queue of everything they
+ * look at, and the select_table remembers where, so that free_wait()
+ * can take it off again. The xxx_select() functions return 1 if the
+ * file is ready for 'sel_type', and otherwise hand their wait queue to
+ * select_wait() (which does nothing if the table is NULL).
+ */
+#define SEL_IN		1
+#define SEL_OUT		2
+#define SEL_EX		4
+
+struct select_table_entry {
+	struct wait_queue wait;
+	struct wait_queue ** wait_address;
+};
+
+typedef struct select_table_struct {
+	int nr;
+	struct select_table_entry * entry;
+} select_table;
+
+#define MAX_SELECT_TABLE_ENTRIES (4096 / sizeof (struct select_table_entry))
+
+extern void select_wait(struct wait_queue ** wait_address, select_table * p);
+extern void free_wait(select_table * p);
 
 /*
  * Entry into gdt where to find first TSS. 0-nul, 1-cs, 2-ds, 3-syscall
@@ -70,6 +70,15 @@ extern int sys_sgetmask();
 extern int sys_ssetmask();
 extern int sys_setreuid();
 extern int sys_setregid();
+extern int sys_swapon();
+extern int sys_multicall();
+extern int sys_readv();
+extern int sys_writev();
+extern int sys_pread();
+extern int sys_pwrite();
+extern int sys_select();
+extern int sys_poll();
+extern int sys_syslog();
 
 fn_ptr sys_call_table[] = { sys_setup, sys_exit, sys_fork, sys_read,
 sys_write, sys_open, sys_close, sys_waitpid, sys_creat, sys_link,
@@ -83,4 +92,19 @@ sys_getgid, sys_signal, sys_geteuid, sys_getegid, sys_acct, sys_phys,
 sys_lock, sys_ioctl, sys_fcntl, sys_mpx, sys_setpgid, sys_ulimit,
 sys_uname, sys_umask, sys_chroot, sys_ustat, sys_dup2, sys_getppid,
 sys_getpgrp, sys_setsid, sys_sigaction, sys_sgetmask, sys_ssetmask,
-sys_setreuid,sys_setregid };
+sys_setreuid,sys_setregid,sys_swapon, sys_multicall, sys_readv,
+sys_writev, sys_pread, sys_pwrite, sys_select, sys_poll, sys_syslog };
+
+int nr_syscalls = sizeof(sys_call_table)/sizeof(fn_ptr);
+
+/* Flags for the system calls above, by number: see <linux/sched.h> */
+unsigned char sys_call_flags[sizeof(sys_call_table)/sizeof(fn_ptr)] = {
+/*  0 */	0, 0, SC_NOBATCH, 0, 0, 0, 0, 0, 0, 0,
+/* 10 */	0, SC_NOBATCH, 0, 0, 0, 0, 0, 0, 0, 0,
+/* 20 */	SC_FAST, 0, 0, 0, SC_FAST, 0, 0, SC_FAST, 0, 0,
+/* 30 */	0, 0, 0, 0, SC_FAST, 0, 0, 0, 0, 0,
+/* 40 */	0, 0, 0, 0, SC_6ARGS, 0, 0, SC_FAST, 0, SC_FAST,
+/* 50 */	SC_FAST, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+/* 60 */	SC_FAST, 0, 0, 0, SC_FAST, SC_FAST, 0, 0, SC_FAST, 0,
+/* 70 */	0, 0, 0, SC_NOBATCH, 0, 0, SC_6ARGS, SC_6ARGS, SC_6ARGS, 0,
+/* 80 */	0 };
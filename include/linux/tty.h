@@ -13,25 +13,38 @@
 
 #define TTY_BUF_SIZE 1024
 
+/*
+ * The buffer of a queue is set up per tty (see tty_io.c), and its size
+ * must be a power of two. The watermarks are in characters: an input
+ * queue that fills up to 'high' throttles the sender (XOFF or RTS), and
+ * it's let go again at 'low'. Writers sleeping on a full output queue
+ * are woken when it has drained to 'low'.
+ */
 struct tty_queue {
 	unsigned long data;
 	unsigned long head;
 	unsigned long tail;
-	struct task_struct * proc_list;
-	char buf[TTY_BUF_SIZE];
+	struct wait_queue * proc_list;
+	unsigned long mask;		/* size of buf - 1 */
+	unsigned long low;
+	unsigned long high;
+	char * buf;
 };
 
-#define INC(a) ((a) = ((a)+1) & (TTY_BUF_SIZE-1))
-#define DEC(a) ((a) = ((a)-1) & (TTY_BUF_SIZE-1))
+#define TTY_QUEUE(data,buf) \
+{(data),0,0,0,sizeof(buf)-1,sizeof(buf)/4,3*sizeof(buf)/4,(buf)}
+
+#define INC(q,a) ((a) = ((a)+1) & (q).mask)
+#define DEC(q,a) ((a) = ((a)-1) & (q).mask)
 #define EMPTY(a) ((a).head == (a).tail)
-#define LEFT(a) (((a).tail-(a).head-1)&(TTY_BUF_SIZE-1))
-#define LAST(a) ((a).buf[(TTY_BUF_SIZE-1)&((a).head-1)])
+#define LEFT(a) (((a).tail-(a).head-1)&(a).mask)
+#define LAST(a) ((a).buf[(a).mask&((a).head-1)])
 #define FULL(a) (!LEFT(a))
-#define CHARS(a) (((a).head-(a).tail)&(TTY_BUF_SIZE-1))
+#define CHARS(a) (((a).head-(a).tail)&(a).mask)
 #define GETCH(queue,c) \
-(void)({c=(queue).buf[(queue).tail];INC((queue).tail);})
+(void)({c=(queue).buf[(queue).tail];INC((queue),(queue).tail);})
 #define PUTCH(c,queue) \
-(void)({(queue).buf[(queue).head]=(c);INC((queue).head);})
+(void)({(queue).buf[(queue).head]=(c);INC((queue),(queue).head);})
 
 #define INTR_CHAR(tty) ((tty)->termios.c_cc[VINTR])
 #define QUIT_CHAR(tty) ((tty)->termios.c_cc[VQUIT])
@@ -45,14 +58,27 @@ struct tty_queue {
 struct tty_struct {
 	struct termios termios;
 	int pgrp;
-	int stopped;
+	int stopped;		/* by ^S */
+	int hw_stopped;		/* by CTS */
+	int throttled;
 	void (*write)(struct tty_struct * tty);
-	struct tty_queue read_q;
+	int (*throttle)(struct tty_struct * tty, int on);
+	int x_char;		/* XOFF/XON to send before write_q, or 0 */
+	struct tty_queue read_q;	/* rs_io.s finds x_char just before this */
 	struct tty_queue write_q;
 	struct tty_queue secondary;
 	};
 
+/*
+ * The first console is tty 0 and the serial lines are 1 and 2, as they
+ * have always been: the other virtual consoles follow from 3 on.
+ */
+#define NR_CONSOLES	4
+#define NR_TTYS		(NR_CONSOLES+2)
+#define CONSOLE_TTY(nr)	((nr) ? (nr)+2 : 0)
+
 extern struct tty_struct tty_table[];
+extern int fg_console;
 
 /*	intr=^C		quit=^|		erase=del	kill=^U
 	eof=^D		vtime=\0	vmin=\1		sxtc=\0
@@ -66,11 +92,15 @@ void rs_init(void);
 void con_init(void);
 void tty_init(void);
 
-int tty_read(unsigned c, char * buf, int n);
-int tty_write(unsigned c, char * buf, int n);
+int tty_read(unsigned c, char * buf, int n, int flags);
+int tty_write(unsigned c, char * buf, int n, int flags);
+struct select_table_struct;
+int tty_select(unsigned c, int sel_type, struct select_table_struct * wait);
 
 void rs_write(struct tty_struct * tty);
+int rs_throttle(struct tty_struct * tty, int on);
 void con_write(struct tty_struct * tty);
+void change_console(unsigned int new_console);
 
 void copy_to_cooked(struct tty_struct * tty);
 
@@ -0,0 +1,23 @@
+#ifndef _SYS_SELECT_H
+#define _SYS_SELECT_H
+
+#include <sys/types.h>
+
+struct timeval {
+	long tv_sec;		/* seconds */
+	long tv_usec;		/* microseconds */
+};
+
+/* NR_OPEN is 20, so one long has room for all the descriptors */
+typedef unsigned long fd_set;
+
+#define FD_SETSIZE		(8*sizeof(fd_set))
+#define FD_SET(fd,fdsetp)	(*(fdsetp) |= (1UL << (fd)))
+#define FD_CLR(fd,fdsetp)	(*(fdsetp) &= ~(1UL << (fd)))
+#define FD_ISSET(fd,fdsetp)	((*(fdsetp) >> (fd)) & 1)
+#define FD_ZERO(fdsetp)		(*(fdsetp) = 0)
+
+extern int select(int nfds, fd_set * readfds, fd_set * writefds,
+	fd_set * exceptfds, struct timeval * timeout);
+
+#endif
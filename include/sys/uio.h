@@ -0,0 +1,17 @@
+#ifndef _SYS_UIO_H
+#define _SYS_UIO_H
+
+#include <sys/types.h>
+
+struct iovec {
+	void * iov_base;
+	size_t iov_len;
+};
+
+/* max number of iovecs to a readv/writev */
+#define UIO_MAXIOV	16
+
+extern int readv(int fildes, const struct iovec * iov, int iovcnt);
+extern int writev(int fildes, const struct iovec * iov, int iovcnt);
+
+#endif
@@ -29,6 +29,24 @@
 #define SEEK_CUR	1
 #define SEEK_END	2
 
+/* multicall: one record per system call, results are filled in */
+struct multicall {
+	long mc_nr;
+	long mc_args[6];
+	long mc_result;
+};
+
+#define MC_STOP_ON_ERROR	1
+#define MC_MAX_CALLS		4096	/* records in one multicall() */
+
+/* commands to syslog(), which reads the kernel message log */
+#define SYSLOG_READ		2
+#define SYSLOG_READ_ALL		3
+#define SYSLOG_READ_CLEAR	4
+#define SYSLOG_CLEAR		5
+#define SYSLOG_CONSOLE_OFF	6
+#define SYSLOG_CONSOLE_ON	7
+
 /* _SC stands for System Configuration. We don't use them much */
 #define _SC_ARG_MAX		1
 #define _SC_CHILD_MAX		2
@@ -129,6 +147,15 @@
 #define __NR_ssetmask	69
 #define __NR_setreuid	70
 #define __NR_setregid	71
+#define __NR_swapon	72
+#define __NR_multicall	73
+#define __NR_readv	74
+#define __NR_writev	75
+#define __NR_pread	76
+#define __NR_pwrite	77
+#define __NR_select	78
+#define __NR_poll	79
+#define __NR_syslog	80
 
 #define _syscall0(type,name) \
 type name(void) \
@@ -182,6 +209,54 @@ errno=-__res; \
 return -1; \
 }
 
+#define _syscall4(type,name,atype,a,btype,b,ctype,c,dtype,d) \
+type name(atype a,btype b,ctype c,dtype d) \
+{ \
+long __res; \
+__asm__ volatile ("int $0x80" \
+	: "=a" (__res) \
+	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c)), \
+	  "S" ((long)(d))); \
+if (__res>=0) \
+	return (type) __res; \
+errno=-__res; \
+return -1; \
+}
+
+#define _syscall5(type,name,atype,a,btype,b,ctype,c,dtype,d,etype,e) \
+type name(atype a,btype b,ctype c,dtype d,etype e) \
+{ \
+long __res; \
+__asm__ volatile ("int $0x80" \
+	: "=a" (__res) \
+	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c)), \
+	  "S" ((long)(d)),"D" ((long)(e))); \
+if (__res>=0) \
+	return (type) __res; \
+errno=-__res; \
+return -1; \
+}
+
+/* the sixth argument goes in %ebp, which we have to save ourselves */
+#define _syscall6(type,name,atype,a,btype,b,ctype,c,dtype,d,etype,e,ftype,f) \
+type name(atype a,btype b,ctype c,dtype d,etype e,ftype f) \
+{ \
+long __res; \
+__asm__ volatile ("pushl %7\n\t" \
+	"pushl %%ebp\n\t" \
+	"movl 4(%%esp),%%ebp\n\t" \
+	"int $0x80\n\t" \
+	"popl %%ebp\n\t" \
+	"addl $4,%%esp" \
+	: "=a" (__res) \
+	: "0" (__NR_##name),"b" ((long)(a)),"c" ((long)(b)),"d" ((long)(c)), \
+	  "S" ((long)(d)),"D" ((long)(e)),"g" ((long)(f))); \
+if (__res>=0) \
+	return (type) __res; \
+errno=-__res; \
+return -1; \
+}
+
 #endif /* __LIBRARY__ */
 
 extern int errno;
@@ -224,6 +299,9 @@ int open(const char * filename, int flag, ...);
 int pause(void);
 int pipe(int * fildes);
 int read(int fildes, char * buf, off_t count);
+int pread(int fildes, char * buf, off_t count, off_t offset);
+int profil(unsigned short * buf, unsigned long size, unsigned long offset,
+	unsigned int scale);
 int setpgrp(void);
 int setpgid(pid_t pid,pid_t pgid);
 int setuid(uid_t uid);
@@ -245,9 +323,13 @@ int utime(const char * filename, struct utimbuf * times);
 pid_t waitpid(pid_t pid,int * wait_stat,int options);
 pid_t wait(int * wait_stat);
 int write(int fildes, const char * buf, off_t count);
+int pwrite(int fildes, const char * buf, off_t count, off_t offset);
 int dup2(int oldfd, int newfd);
 int getppid(void);
 pid_t getpgrp(void);
 pid_t setsid(void);
+int swapon(const char * specialfile);
+int multicall(struct multicall * calls, int nr, int flags);
+int syslog(int type, char * buf, int len);
 
 #endif
@@ -49,6 +49,7 @@ extern void hd_init(void);
 extern void floppy_init(void);
 extern void mem_init(long start, long end);
 extern long rd_init(long mem_start, int length);
+extern long prof_init(long mem_start, int shift);
 extern long kernel_mktime(struct tm * tm);
 extern long startup_time;
 
@@ -120,16 +121,18 @@ void main(void)		/* This really IS void, no error here. */
 	if (memory_end > 16*1024*1024)
 		memory_end = 16*1024*1024;
 		//设置高速缓冲区大小
-	if (memory_end > 12*1024*1024) 
-		buffer_memory_end = 4*1024*1024;
-	else if (memory_end > 6*1024*1024)
-		buffer_memory_end = 2*1024*1024;
-	else
-		buffer_memory_end = 1*1024*1024;
+/*
+ * This is just the minimum: the buffer cache grows into main memory
+ * while there is free memory, and gives it back when it runs out.
+ */
+	buffer_memory_end = 1*1024*1024;
 		//设置主内存开始地址
 	main_memory_start = buffer_memory_end;
 #ifdef RAMDISK
 	main_memory_start += rd_init(main_memory_start, RAMDISK*1024);
+#endif
+#ifdef PROFILE
+	main_memory_start += prof_init(main_memory_start, PROFILE);
 #endif
 	mem_init(main_memory_start,memory_end);//内存初始化
 	trap_init(); //异常函数初始化
@@ -28,6 +28,7 @@ struct request {
 	unsigned long nr_sectors;
 	char * buffer;
 	struct task_struct * waiting;
+	int * uptodate;		/* paging: where the result goes */
 	struct buffer_head * bh;
 	struct request * next;
 };
@@ -49,7 +50,7 @@ struct blk_dev_struct {
 
 extern struct blk_dev_struct blk_dev[NR_BLK_DEV];
 extern struct request request[NR_REQUEST];
-extern struct task_struct * wait_for_request;
+extern struct wait_queue * wait_for_request;
 
 #ifdef MAJOR_NR
 
@@ -103,7 +104,7 @@ extern inline void unlock_buffer(struct buffer_head * bh)
 	if (!bh->b_lock)
 		printk(DEVICE_NAME ": free buffer being unlocked\n");
 	bh->b_lock=0;
-	wake_up(&bh->b_wait);
+	wake_up_one(&bh->b_wait);
 }
 
 extern inline void end_request(int uptodate)
@@ -113,13 +114,16 @@ extern inline void end_request(int uptodate)
 		CURRENT->bh->b_uptodate = uptodate;
 		unlock_buffer(CURRENT->bh);
 	}
+	if (CURRENT->uptodate)
+		*CURRENT->uptodate = uptodate;
 	if (!uptodate) {
 		printk(DEVICE_NAME " I/O error\n\r");
 		printk("dev %04x, block %d\n\r",CURRENT->dev,
-			CURRENT->bh->b_blocknr);
+			CURRENT->sector>>1);
 	}
-	wake_up(&CURRENT->waiting);
-	wake_up(&wait_for_request);
+	if (CURRENT->waiting)
+		wake_up_process(CURRENT->waiting);
+	wake_up_one(&wait_for_request);
 	CURRENT->dev = -1;
 	CURRENT = CURRENT->next;
 }
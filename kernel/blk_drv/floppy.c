@@ -120,7 +120,7 @@ static unsigned char seek_track = 0;
 static unsigned char current_track = 255;
 static unsigned char command = 0;
 unsigned char selected = 0;
-struct task_struct * wait_on_floppy_select = NULL;
+struct wait_queue * wait_on_floppy_select = NULL;
 
 void floppy_deselect(unsigned int nr)
 {
@@ -401,6 +401,30 @@ static void reset_floppy(void)
 	sti();
 }
 
+/*
+ * There is never more than one floppy timer pending: wait for the motor,
+ * then wait for the drive select to settle.
+ */
+static struct timer_list fd_timer = {NULL,NULL,0,0,NULL};
+
+static void fd_timer_fn(unsigned long fn)
+{
+	((void (*)(void)) fn)();
+}
+
+static void fd_add_timer(long ticks, void (*fn)(void))
+{
+	del_timer(&fd_timer);
+	if (ticks <= 0) {
+		fn();
+		return;
+	}
+	fd_timer.expires = jiffies + ticks;
+	fd_timer.data = (unsigned long) fn;
+	fd_timer.function = fd_timer_fn;
+	add_timer(&fd_timer);
+}
+
 static void floppy_on_interrupt(void)
 {
 /* We cannot do a floppy-select, as that might sleep. We just force it */
@@ -409,7 +433,7 @@ static void floppy_on_interrupt(void)
 		current_DOR &= 0xFC;
 		current_DOR |= current_drive;
 		outb(current_DOR,FD_DOR);
-		add_timer(2,&transfer);
+		fd_add_timer(2,&transfer);
 	} else
 		transfer();
 }
@@ -451,7 +475,7 @@ void do_fd_request(void)
 		command = FD_WRITE;
 	else
 		panic("do_fd_request: unknown command");
-	add_timer(ticks_to_floppy_on(current_drive),&floppy_on_interrupt);
+	fd_add_timer(ticks_to_floppy_on(current_drive),&floppy_on_interrupt);
 }
 
 void floppy_init(void)
@@ -23,7 +23,7 @@ struct request request[NR_REQUEST];
 /*
  * used to wait on when there are no free requests
  */
-struct task_struct * wait_for_request = NULL;
+struct wait_queue * wait_for_request = NULL;
 
 /* blk_dev_struct is:
  *	do_request-address
@@ -39,11 +39,29 @@ struct blk_dev_struct blk_dev[NR_BLK_DEV] = {
 	{ NULL, NULL }		/* dev lp */
 };
 
+/*
+ * For /proc: the number of requests queued on a major, counting the one
+ * being done. -1 if there is no such major.
+ */
+int blk_queue_depth(int major)
+{
+	struct request * req;
+	int n = 0;
+
+	if (major < 0 || major >= NR_BLK_DEV)
+		return -1;
+	cli();
+	for (req = blk_dev[major].current_request ; req ; req = req->next)
+		n++;
+	sti();
+	return n;
+}
+
 static inline void lock_buffer(struct buffer_head * bh)
 {
 	cli();
 	while (bh->b_lock)
-		sleep_on(&bh->b_wait);
+		sleep_on_exclusive(&bh->b_wait);
 	bh->b_lock=1;
 	sti();
 }
@@ -53,7 +71,7 @@ static inline void unlock_buffer(struct buffer_head * bh)
 	if (!bh->b_lock)
 		printk("ll_rw_block.c: buffer not locked\n\r");
 	bh->b_lock = 0;
-	wake_up(&bh->b_wait);
+	wake_up_one(&bh->b_wait);
 }
 
 /*
@@ -126,7 +144,7 @@ repeat:
 			unlock_buffer(bh);
 			return;
 		}
-		sleep_on(&wait_for_request);
+		sleep_on_exclusive(&wait_for_request);
 		goto repeat;
 	}
 /* fill up the request-info, and add it to the queue */
@@ -137,6 +155,7 @@ repeat:
 	req->nr_sectors = 2;
 	req->buffer = bh->b_data;
 	req->waiting = NULL;
+	req->uptodate = NULL;
 	req->bh = bh;
 	req->next = NULL;
 	add_request(major+blk_dev,req);
@@ -154,6 +173,50 @@ void ll_rw_block(int rw, struct buffer_head * bh) //块设备通用读写函数
 	make_request(major,rw,bh);
 }
 
+/*
+ * ll_rw_page reads or writes a whole page directly, without going
+ * through the buffer cache. This is what the swapper uses: the request
+ * has no buffer_head, and we sleep on 'waiting' until it's done.
+ * Returns 1 if the transfer went ok, 0 on an I/O error.
+ */
+int ll_rw_page(int rw, int dev, int page, char * buffer)
+{
+	struct request * req;
+	unsigned int major = MAJOR(dev);
+	int uptodate = 0;
+
+	if (major >= NR_BLK_DEV || !(blk_dev[major].request_fn)) {
+		printk("Trying to read nonexistent block-device\n\r");
+		return 0;
+	}
+	if (rw!=READ && rw!=WRITE)
+		panic("Bad block dev command, must be R/W");
+repeat:
+	req = request+NR_REQUEST;
+	while (--req >= request)
+		if (req->dev<0)
+			break;
+	if (req < request) {
+		sleep_on_exclusive(&wait_for_request);
+		goto repeat;
+	}
+/* fill up the request-info, and add it to the queue */
+	req->dev = dev;
+	req->cmd = rw;
+	req->errors = 0;
+	req->sector = page<<3;
+	req->nr_sectors = 8;
+	req->buffer = buffer;
+	req->waiting = current;
+	req->uptodate = &uptodate;
+	req->bh = NULL;
+	req->next = NULL;
+	current->state = TASK_UNINTERRUPTIBLE;
+	add_request(major+blk_dev,req);
+	schedule();
+	return uptodate;
+}
+
 void blk_dev_init(void)
 {
 	int i;
@@ -10,11 +10,22 @@
  * This module implements the console io functions
  *	'void con_init(void)'
  *	'void con_write(struct tty_queue * queue)'
+ *	'void change_console(unsigned int new_console)'
  * Hopefully this will be a rather complete VT102 implementation.
  *
  * Beeping thanks to John T Kohl.
  */
 
+/*
+ * There are NR_CONSOLES virtual consoles. Each has its own copy of the
+ * terminal state below (see the defines after 'struct vc_data'), so
+ * every routine here works on the console 'currcons'. Only the
+ * foreground console lives in video memory: the others are kept in a
+ * page of their own, where writing and scrolling is plain memory
+ * copying. Switching (alt-Fn) copies the old foreground screen out to
+ * its page, and the new one in.
+ */
+
 /*
  *  NOTE!!! We sometimes disable and enable interrupts for a short while
  * (to put a word in video IO), but this will work even for keyboard
@@ -29,6 +40,8 @@
 
 #include <linux/sched.h>
 #include <linux/tty.h>
+#include <linux/mm.h>
+#include <linux/interrupt.h>
 #include <asm/io.h>
 #include <asm/system.h>
 
@@ -66,15 +79,45 @@ static unsigned short	video_port_reg;		/* Video register select port	*/
 static unsigned short	video_port_val;		/* Video register value port	*/
 static unsigned short	video_erase_char;	/* Char+Attrib to erase with	*/
 
-static unsigned long	origin;		/* Used for EGA/VGA fast scroll	*/
-static unsigned long	scr_end;	/* Used for EGA/VGA fast scroll	*/
-static unsigned long	pos;
-static unsigned long	x,y;
-static unsigned long	top,bottom;
-static unsigned long	state=0;
-static unsigned long	npar,par[NPAR];
-static unsigned long	ques=0;
-static unsigned char	attr=0x07;
+static unsigned long	screen_size;		/* Bytes per screen		*/
+static unsigned long	cursor_pos=0;	/* Where the hardware cursor is	*/
+static int		origin_changed=0;
+
+int			fg_console=0;		/* Console on the screen	*/
+static int		nr_consoles=1;		/* Consoles we have pages for	*/
+static int		want_console=-1;	/* Set by the keyboard		*/
+
+static struct vc_data {
+	unsigned long	vc_origin;		/* Used for EGA/VGA fast scroll	*/
+	unsigned long	vc_scr_end;		/* Used for EGA/VGA fast scroll	*/
+	unsigned long	vc_pos;
+	unsigned long	vc_x,vc_y;
+	unsigned long	vc_top,vc_bottom;
+	unsigned long	vc_state;
+	unsigned long	vc_npar,vc_par[NPAR];
+	unsigned long	vc_ques;
+	unsigned char	vc_attr;
+	int		vc_saved_x;
+	int		vc_saved_y;
+	unsigned long	vc_page;		/* Screen while in background	*/
+} vc_cons[NR_CONSOLES];
+
+#define origin		(vc_cons[currcons].vc_origin)
+#define scr_end		(vc_cons[currcons].vc_scr_end)
+#define pos		(vc_cons[currcons].vc_pos)
+#define x		(vc_cons[currcons].vc_x)
+#define y		(vc_cons[currcons].vc_y)
+#define top		(vc_cons[currcons].vc_top)
+#define bottom		(vc_cons[currcons].vc_bottom)
+#define state		(vc_cons[currcons].vc_state)
+#define npar		(vc_cons[currcons].vc_npar)
+#define par		(vc_cons[currcons].vc_par)
+#define ques		(vc_cons[currcons].vc_ques)
+#define attr		(vc_cons[currcons].vc_attr)
+#define saved_x		(vc_cons[currcons].vc_saved_x)
+#define saved_y		(vc_cons[currcons].vc_saved_y)
+
+extern struct tty_queue * table_list[];
 
 static void sysbeep(void);
 
@@ -85,7 +128,7 @@ static void sysbeep(void);
 #define RESPONSE "\033[?1;2c"
 
 /* NOTE! gotoxy thinks x==video_num_columns is ok */
-static inline void gotoxy(unsigned int new_x,unsigned int new_y)
+static inline void gotoxy(int currcons, unsigned int new_x,unsigned int new_y)
 {
 	if (new_x > video_num_columns || new_y >= video_num_lines)
 		return;
@@ -94,8 +137,10 @@ static inline void gotoxy(unsigned int new_x,unsigned int new_y)
 	pos=origin + y*video_size_row + (x<<1);
 }
 
-static inline void set_origin(void)
+static inline void set_origin(int currcons)
 {
+	if (currcons != fg_console)
+		return;
 	cli();
 	outb_p(12, video_port_reg);
 	outb_p(0xff&((origin-video_mem_start)>>9), video_port_val);
@@ -104,9 +149,10 @@ static inline void set_origin(void)
 	sti();
 }
 
-static void scrup(void)
+static void scrup(int currcons)
 {
-	if (video_type == VIDEO_TYPE_EGAC || video_type == VIDEO_TYPE_EGAM)
+	if (currcons == fg_console &&
+	    (video_type == VIDEO_TYPE_EGAC || video_type == VIDEO_TYPE_EGAM))
 	{
 		if (!top && bottom == video_num_lines) {
 			origin += video_size_row;
@@ -136,7 +182,7 @@ static void scrup(void)
 					"D" (scr_end-video_size_row)
 					:"cx","di");
 			}
-			set_origin();
+			origin_changed = 1;	/* con_write() tells the card */
 		} else {
 			__asm__("cld\n\t"
 				"rep\n\t"
@@ -167,7 +213,7 @@ static void scrup(void)
 	}
 }
 
-static void scrdown(void)
+static void scrdown(int currcons)
 {
 	if (video_type == VIDEO_TYPE_EGAC || video_type == VIDEO_TYPE_EGAM)
 	{
@@ -201,33 +247,33 @@ static void scrdown(void)
 	}
 }
 
-static void lf(void)
+static void lf(int currcons)
 {
 	if (y+1<bottom) {
 		y++;
 		pos += video_size_row;
 		return;
 	}
-	scrup();
+	scrup(currcons);
 }
 
-static void ri(void)
+static void ri(int currcons)
 {
 	if (y>top) {
 		y--;
 		pos -= video_size_row;
 		return;
 	}
-	scrdown();
+	scrdown(currcons);
 }
 
-static void cr(void)
+static void cr(int currcons)
 {
 	pos -= x<<1;
 	x=0;
 }
 
-static void del(void)
+static void del(int currcons)
 {
 	if (x) {
 		pos -= 2;
@@ -236,12 +282,12 @@ static void del(void)
 	}
 }
 
-static void csi_J(int par)
+static void csi_J(int currcons, int vpar)
 {
 	long count __asm__("cx");
 	long start __asm__("di");
 
-	switch (par) {
+	switch (vpar) {
 		case 0:	/* erase from cursor to end of display */
 			count = (scr_end-pos)>>1;
 			start = pos;
@@ -265,12 +311,12 @@ static void csi_J(int par)
 		:"cx","di");
 }
 
-static void csi_K(int par)
+static void csi_K(int currcons, int vpar)
 {
 	long count __asm__("cx");
 	long start __asm__("di");
 
-	switch (par) {
+	switch (vpar) {
 		case 0:	/* erase from cursor to end of line */
 			if (x>=video_num_columns)
 				return;
@@ -296,7 +342,7 @@ static void csi_K(int par)
 		:"cx","di");
 }
 
-void csi_m(void)
+void csi_m(int currcons)
 {
 	int i;
 
@@ -310,8 +356,11 @@ void csi_m(void)
 		}
 }
 
-static inline void set_cursor(void)
+static inline void set_cursor(int currcons)
 {
+	if (currcons != fg_console || pos == cursor_pos)
+		return;
+	cursor_pos = pos;
 	cli();
 	outb_p(14, video_port_reg);
 	outb_p(0xff&((pos-video_mem_start)>>9), video_port_val);
@@ -333,7 +382,7 @@ static void respond(struct tty_struct * tty)
 	copy_to_cooked(tty);
 }
 
-static void insert_char(void)
+static void insert_char(int currcons)
 {
 	int i=x;
 	unsigned short tmp, old = video_erase_char;
@@ -347,7 +396,7 @@ static void insert_char(void)
 	}
 }
 
-static void insert_line(void)
+static void insert_line(int currcons)
 {
 	int oldtop,oldbottom;
 
@@ -355,12 +404,12 @@ static void insert_line(void)
 	oldbottom=bottom;
 	top=y;
 	bottom = video_num_lines;
-	scrdown();
+	scrdown(currcons);
 	top=oldtop;
 	bottom=oldbottom;
 }
 
-static void delete_char(void)
+static void delete_char(int currcons)
 {
 	int i;
 	unsigned short * p = (unsigned short *) pos;
@@ -375,7 +424,7 @@ static void delete_char(void)
 	*p = video_erase_char;
 }
 
-static void delete_line(void)
+static void delete_line(int currcons)
 {
 	int oldtop,oldbottom;
 
@@ -383,70 +432,112 @@ static void delete_line(void)
 	oldbottom=bottom;
 	top=y;
 	bottom = video_num_lines;
-	scrup();
+	scrup(currcons);
 	top=oldtop;
 	bottom=oldbottom;
 }
 
-static void csi_at(unsigned int nr)
+static void csi_at(int currcons, unsigned int nr)
 {
 	if (nr > video_num_columns)
 		nr = video_num_columns;
 	else if (!nr)
 		nr = 1;
 	while (nr--)
-		insert_char();
+		insert_char(currcons);
 }
 
-static void csi_L(unsigned int nr)
+static void csi_L(int currcons, unsigned int nr)
 {
 	if (nr > video_num_lines)
 		nr = video_num_lines;
 	else if (!nr)
 		nr = 1;
 	while (nr--)
-		insert_line();
+		insert_line(currcons);
 }
 
-static void csi_P(unsigned int nr)
+static void csi_P(int currcons, unsigned int nr)
 {
 	if (nr > video_num_columns)
 		nr = video_num_columns;
 	else if (!nr)
 		nr = 1;
 	while (nr--)
-		delete_char();
+		delete_char(currcons);
 }
 
-static void csi_M(unsigned int nr)
+static void csi_M(int currcons, unsigned int nr)
 {
 	if (nr > video_num_lines)
 		nr = video_num_lines;
 	else if (!nr)
 		nr=1;
 	while (nr--)
-		delete_line();
+		delete_line(currcons);
 }
 
-static int saved_x=0;
-static int saved_y=0;
-
-static void save_cur(void)
+static void save_cur(int currcons)
 {
 	saved_x=x;
 	saved_y=y;
 }
 
-static void restore_cur(void)
+static void restore_cur(int currcons)
 {
-	gotoxy(saved_x, saved_y);
+	gotoxy(currcons,saved_x, saved_y);
 }
 
+/*
+ * Returns how many printable characters follow in the queue, at most
+ * 'max'. The run stops where the buffer wraps, so that it can be copied
+ * to the screen straight from the queue.
+ */
+static inline int printable_run(struct tty_queue * q, int max)
+{
+	char * p = q->buf + q->tail;
+	int n = 0;
+
+	if (max > q->mask + 1 - q->tail)
+		max = q->mask + 1 - q->tail;
+	while (n < max && p[n] > 31 && p[n] < 127)
+		n++;
+	return n;
+}
+
+/*
+ * Put 'n' characters on the screen at the cursor, in the current
+ * attribute. The caller makes sure they fit on the line.
+ */
+static inline void blit(int currcons, char * from, int n)
+{
+	__asm__("cld\n"
+		"1:\tlodsb\n\t"
+		"stosw\n\t"
+		"loop 1b"
+		::"a" (attr<<8),"c" (n),"S" (from),"D" (pos)
+		:"ax","cx","si","di");
+	pos += n<<1;
+	x += n;
+}
+
+/*
+ * con_write() empties the write queue onto the screen. Printable
+ * characters are the common case, so whole runs of them are copied
+ * out of the queue at once instead of going through the state machine
+ * one by one. The video card is only told about a new origin and cursor
+ * position once per call, not for every line feed.
+ */
 void con_write(struct tty_struct * tty)
 {
-	int nr;
+	int currcons = tty->write_q.data;
+	int nr, n;
 	char c;
 
+	if (currcons >= nr_consoles) {
+		tty->write_q.tail = tty->write_q.head;
+		return;
+	}
 	nr = CHARS(tty->write_q);
 	while (nr--) {
 		GETCH(tty->write_q,c);
@@ -456,22 +547,32 @@ void con_write(struct tty_struct * tty)
 					if (x>=video_num_columns) {
 						x -= video_num_columns;
 						pos -= video_size_row;
-						lf();
+						lf(currcons);
 					}
-					__asm__("movb _attr,%%ah\n\t"
+					__asm__("movb %2,%%ah\n\t"
 						"movw %%ax,%1\n\t"
-						::"a" (c),"m" (*(short *)pos)
+						::"a" (c),"m" (*(short *)pos),
+						"m" (attr)
 						:"ax");
 					pos += 2;
 					x++;
+					n = video_num_columns - x;
+					if (n > nr)
+						n = nr;
+					if (n && (n = printable_run(&tty->write_q,n))) {
+						blit(currcons,tty->write_q.buf+tty->write_q.tail,n);
+						tty->write_q.tail = (tty->write_q.tail+n) &
+							tty->write_q.mask;
+						nr -= n;
+					}
 				} else if (c==27)
 					state=1;
 				else if (c==10 || c==11 || c==12)
-					lf();
+					lf(currcons);
 				else if (c==13)
-					cr();
+					cr(currcons);
 				else if (c==ERASE_CHAR(tty))
-					del();
+					del(currcons);
 				else if (c==8) {
 					if (x) {
 						x--;
@@ -484,7 +585,7 @@ void con_write(struct tty_struct * tty)
 					if (x>video_num_columns) {
 						x -= video_num_columns;
 						pos -= video_size_row;
-						lf();
+						lf(currcons);
 					}
 					c=9;
 				} else if (c==7)
@@ -495,17 +596,17 @@ void con_write(struct tty_struct * tty)
 				if (c=='[')
 					state=2;
 				else if (c=='E')
-					gotoxy(0,y+1);
+					gotoxy(currcons,0,y+1);
 				else if (c=='M')
-					ri();
+					ri(currcons);
 				else if (c=='D')
-					lf();
+					lf(currcons);
 				else if (c=='Z')
 					respond(tty);
 				else if (x=='7')
-					save_cur();
+					save_cur(currcons);
 				else if (x=='8')
-					restore_cur();
+					restore_cur(currcons);
 				break;
 			case 2:
 				for(npar=0;npar<NPAR;npar++)
@@ -527,61 +628,61 @@ void con_write(struct tty_struct * tty)
 				switch(c) {
 					case 'G': case '`':
 						if (par[0]) par[0]--;
-						gotoxy(par[0],y);
+						gotoxy(currcons,par[0],y);
 						break;
 					case 'A':
 						if (!par[0]) par[0]++;
-						gotoxy(x,y-par[0]);
+						gotoxy(currcons,x,y-par[0]);
 						break;
 					case 'B': case 'e':
 						if (!par[0]) par[0]++;
-						gotoxy(x,y+par[0]);
+						gotoxy(currcons,x,y+par[0]);
 						break;
 					case 'C': case 'a':
 						if (!par[0]) par[0]++;
-						gotoxy(x+par[0],y);
+						gotoxy(currcons,x+par[0],y);
 						break;
 					case 'D':
 						if (!par[0]) par[0]++;
-						gotoxy(x-par[0],y);
+						gotoxy(currcons,x-par[0],y);
 						break;
 					case 'E':
 						if (!par[0]) par[0]++;
-						gotoxy(0,y+par[0]);
+						gotoxy(currcons,0,y+par[0]);
 						break;
 					case 'F':
 						if (!par[0]) par[0]++;
-						gotoxy(0,y-par[0]);
+						gotoxy(currcons,0,y-par[0]);
 						break;
 					case 'd':
 						if (par[0]) par[0]--;
-						gotoxy(x,par[0]);
+						gotoxy(currcons,x,par[0]);
 						break;
 					case 'H': case 'f':
 						if (par[0]) par[0]--;
 						if (par[1]) par[1]--;
-						gotoxy(par[1],par[0]);
+						gotoxy(currcons,par[1],par[0]);
 						break;
 					case 'J':
-						csi_J(par[0]);
+						csi_J(currcons,par[0]);
 						break;
 					case 'K':
-						csi_K(par[0]);
+						csi_K(currcons,par[0]);
 						break;
 					case 'L':
-						csi_L(par[0]);
+						csi_L(currcons,par[0]);
 						break;
 					case 'M':
-						csi_M(par[0]);
+						csi_M(currcons,par[0]);
 						break;
 					case 'P':
-						csi_P(par[0]);
+						csi_P(currcons,par[0]);
 						break;
 					case '@':
-						csi_at(par[0]);
+						csi_at(currcons,par[0]);
 						break;
 					case 'm':
-						csi_m();
+						csi_m(currcons);
 						break;
 					case 'r':
 						if (par[0]) par[0]--;
@@ -593,15 +694,72 @@ void con_write(struct tty_struct * tty)
 						}
 						break;
 					case 's':
-						save_cur();
+						save_cur(currcons);
 						break;
 					case 'u':
-						restore_cur();
+						restore_cur(currcons);
 						break;
 				}
 		}
 	}
-	set_cursor();
+	if (origin_changed) {
+		origin_changed = 0;
+		set_origin(currcons);
+	}
+	set_cursor(currcons);
+}
+
+/*
+ * Called by the keyboard interrupt for alt-Fn. The switch itself is left
+ * to the console bottom half: con_write() must never have the screen
+ * moved away under it, and bottom halves don't run while it does.
+ */
+void change_console(unsigned int new_console)
+{
+	if (new_console >= nr_consoles)
+		return;
+	want_console = new_console;
+	mark_bh(CONSOLE_BH);
+}
+
+/* copy the screen of 'currcons' to 'new_origin', and move it there */
+static void move_screen(int currcons, unsigned long new_origin)
+{
+	__asm__("cld\n\t"
+		"rep\n\t"
+		"movsl"
+		::"c" (screen_size>>2),
+		"D" (new_origin),
+		"S" (origin)
+		:"cx","di","si");
+	pos += new_origin - origin;
+	scr_end = new_origin + screen_size;
+	origin = new_origin;
+}
+
+static void console_bh(void * unused)
+{
+	int currcons, new_console;
+
+	cli();
+	new_console = want_console;
+	want_console = -1;
+	sti();
+	if (new_console < 0 || new_console == fg_console)
+		return;
+	currcons = fg_console;
+	move_screen(currcons,vc_cons[currcons].vc_page);
+	currcons = new_console;
+	move_screen(currcons,video_mem_start);
+	cli();
+	fg_console = currcons;
+	table_list[0] = &tty_table[CONSOLE_TTY(currcons)].read_q;
+	table_list[1] = &tty_table[CONSOLE_TTY(currcons)].write_q;
+	sti();
+	origin_changed = 0;
+	set_origin(currcons);
+	cursor_pos = 0;
+	set_cursor(currcons);
 }
 
 /*
@@ -617,6 +775,7 @@ void con_write(struct tty_struct * tty)
 void con_init(void)
 {
 	register unsigned char a;
+	int currcons;
 	char *display_desc = "????";
 	char *display_ptr;
 
@@ -672,14 +831,46 @@ void con_init(void)
 		display_ptr++;
 	}
 	
+	/*
+	 * Every console gets a page to keep its screen in while it isn't in
+	 * the foreground. If the screen doesn't fit a page, or there are no
+	 * pages, we just have the one console.
+	 */
+
+	screen_size = video_num_lines * video_size_row;
+	nr_consoles = 0;
+	if (screen_size <= PAGE_SIZE)
+		while (nr_consoles < NR_CONSOLES &&
+		       (vc_cons[nr_consoles].vc_page = get_free_page()))
+			nr_consoles++;
+	if (nr_consoles < 2)
+		nr_consoles = 1;
+
 	/* Initialize the variables used for scrolling (mostly EGA/VGA)	*/
-	
-	origin	= video_mem_start;
-	scr_end	= video_mem_start + video_num_lines * video_size_row;
-	top	= 0;
-	bottom	= video_num_lines;
 
-	gotoxy(ORIG_X,ORIG_Y);
+	for (currcons = 0 ; currcons < nr_consoles ; currcons++) {
+		origin	= currcons ? vc_cons[currcons].vc_page : video_mem_start;
+		scr_end	= origin + screen_size;
+		top	= 0;
+		bottom	= video_num_lines;
+		state	= 0;
+		ques	= 0;
+		attr	= 0x07;
+		if (currcons) {
+			__asm__("cld\n\t"
+				"rep\n\t"
+				"stosw"
+				::"a" (video_erase_char),
+				"c" (screen_size>>1),
+				"D" (origin)
+				:"cx","di");
+			gotoxy(currcons,0,0);
+		}
+	}
+	currcons = fg_console = 0;
+
+	gotoxy(currcons,ORIG_X,ORIG_Y);
+	init_bh(CONSOLE_BH,console_bh,NULL);
 	set_trap_gate(0x21,&keyboard_interrupt);
 	outb_p(inb_p(0x21)&0xfd,0x21);
 	a=inb_p(0x61);
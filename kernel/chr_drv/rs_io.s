@@ -8,23 +8,33 @@
  *	rs_io.s
  *
  * This module implements the rs232 io interrupts.
+ *
+ * With the FIFOs of a 16550A turned on (see serial.c), one interrupt
+ * can mean several bytes: read_char takes everything the receiver has,
+ * and only then calls do_tty_interrupt(), and write_char gives the
+ * transmitter as many bytes as rs_fifo_size[] says it can take.
+ *
+ * A pending XOFF/XON (x_char) is sent on its own, before anything in
+ * the write queue: rs_x_char_sent() then decides if the transmit
+ * interrupt stays on.
  */
 
 .text
 .globl _rs1_interrupt,_rs2_interrupt
 
-size	= 1024				/* must be power of two !
-					   and must match the value
-					   in tty_io.c!!! */
-
 /* these are the offsets into the read/write buffer structures */
 rs_addr = 0
 head = 4
 tail = 8
 proc_list = 12
-buf = 16
+mask = 16
+low = 20
+high = 24
+buf = 28
 
-startup	= 256		/* chars left in write queue when we restart it */
+x_char = -4		/* in tty_struct, just before the read queue */
+
+max_burst = 32		/* don't loop for ever if the uart goes mad */
 
 /*
  * These are the actual interrupt routines. They look where
@@ -57,7 +67,11 @@ rep_int:
 	inb %dx,%al
 	testb $1,%al
 	jne end
-	cmpb $6,%al		/* this shouldn't happen, but ... */
+	andb $0x0e,%al		/* FIFO enabled bits */
+	cmpb $0x0c,%al		/* character timeout: fifo below trigger */
+	jne 1f
+	movb $4,%al
+1:	cmpb $6,%al		/* this shouldn't happen, but ... */
 	ja end
 	movl 24(%esp),%ecx
 	pushl %edx
@@ -83,6 +97,12 @@ jmp_table:
 modem_status:
 	addl $6,%edx		/* clear intr by reading modem status reg */
 	inb %dx,%al
+	subl $_table_list,%ecx
+	shrl $3,%ecx
+	pushl %eax
+	pushl %ecx
+	call _rs_modem_status
+	addl $8,%esp
 	ret
 
 .align 2
@@ -93,52 +113,104 @@ line_status:
 
 .align 2
 read_char:
-	inb %dx,%al
-	movl %ecx,%edx
-	subl $_table_list,%edx
-	shrl $3,%edx
+	pushl %ecx			# table_list entry, for the channel
+	pushl %esi
 	movl (%ecx),%ecx		# read-queue
+	movl buf(%ecx),%esi
+	movb $max_burst,%ah
+1:	inb %dx,%al
 	movl head(%ecx),%ebx
-	movb %al,buf(%ecx,%ebx)
+	movb %al,(%esi,%ebx)
 	incl %ebx
-	andl $size-1,%ebx
+	andl mask(%ecx),%ebx
 	cmpl tail(%ecx),%ebx
-	je 1f
+	je 2f
 	movl %ebx,head(%ecx)
-1:	pushl %edx
+2:	addl $5,%edx			# line status reg
+	inb %dx,%al
+	subl $5,%edx
+	testb $1,%al			# more data ready?
+	je 3f
+	decb %ah
+	jne 1b
+3:	popl %esi
+	popl %edx
+	subl $_table_list,%edx
+	shrl $3,%edx
+	pushl %edx
 	call _do_tty_interrupt
 	addl $4,%esp
 	ret
 
 .align 2
 write_char:
+	movl %ecx,%ebx
+	subl $_table_list,%ebx
+	shrl $3,%ebx
+	movl (%ecx),%eax		# read-queue
+	movl x_char(%eax),%eax
+	testl %eax,%eax
+	jne send_x_char
+	movb _rs_fifo_size(%ebx),%ah	# bytes the transmitter can take
 	movl 4(%ecx),%ecx		# write-queue
+	pushl %esi
+	movl buf(%ecx),%esi
 	movl head(%ecx),%ebx
 	subl tail(%ecx),%ebx
-	andl $size-1,%ebx		# nr chars in queue
-	je write_buffer_empty
-	cmpl $startup,%ebx
+	andl mask(%ecx),%ebx		# nr chars in queue
+	je 2f
+	cmpl low(%ecx),%ebx		# writers wait for the low watermark
 	ja 1f
-	movl proc_list(%ecx),%ebx	# wake up sleeping process
-	testl %ebx,%ebx			# is there any?
-	je 1f
-	movl $0,(%ebx)
+	call wake_writers
 1:	movl tail(%ecx),%ebx
-	movb buf(%ecx,%ebx),%al
+	movb (%esi,%ebx),%al
 	outb %al,%dx
 	incl %ebx
-	andl $size-1,%ebx
+	andl mask(%ecx),%ebx
 	movl %ebx,tail(%ecx)
 	cmpl head(%ecx),%ebx
-	je write_buffer_empty
+	je 2f
+	decb %ah
+	jne 1b
+	popl %esi
 	ret
+2:	popl %esi
+	jmp write_buffer_empty
+
 .align 2
-write_buffer_empty:
-	movl proc_list(%ecx),%ebx	# wake up sleeping process
-	testl %ebx,%ebx			# is there any?
+send_x_char:
+	outb %al,%dx
+	pushl %ebx
+	call _rs_x_char_sent
+	addl $4,%esp
+	ret
+
+/*
+ * Wake up the writer sleeping on the write queue (in %ecx). Just
+ * setting its state isn't enough: it has to go through wake_up_all(),
+ * to be put back on the run queue. %eax, %ecx and %edx are saved around
+ * the call, %ebx is preserved by C code anyway.
+ */
+.align 2
+wake_writers:
+	cmpl $0,proc_list(%ecx)		# is there anybody?
 	je 1f
-	movl $0,(%ebx)
-1:	incl %edx
+	pushl %eax
+	pushl %edx
+	pushl %ecx
+	leal proc_list(%ecx),%eax
+	pushl %eax
+	call _wake_up_all
+	addl $4,%esp
+	popl %ecx
+	popl %edx
+	popl %eax
+1:	ret
+
+.align 2
+write_buffer_empty:
+	call wake_writers
+	incl %edx
 	inb %dx,%al
 	jmp 1f
 1:	jmp 1f
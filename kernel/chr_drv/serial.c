@@ -9,6 +9,7 @@
  *
  * This module implements the rs232 io functions
  *	void rs_write(struct tty_struct * queue);
+ *	int rs_throttle(struct tty_struct * tty, int on);
  *	void rs_init(void);
  * and all interrupts pertaining to serial IO.
  */
@@ -18,7 +19,27 @@
 #include <asm/system.h>
 #include <asm/io.h>
 
-#define WAKEUP_CHARS (TTY_BUF_SIZE/4)
+/*
+ * FIFO control register bits. The receive trigger level is how many
+ * bytes the 16550A collects before it interrupts (a character timeout
+ * gets the rest): higher means fewer interrupts, lower means less risk
+ * of overrun when interrupts are held off for a while.
+ */
+#define FCR_ENABLE	0x01
+#define FCR_CLEAR_RCVR	0x02
+#define FCR_CLEAR_XMIT	0x04
+#define FCR_TRIGGER_1	0x00
+#define FCR_TRIGGER_4	0x40
+#define FCR_TRIGGER_8	0x80
+#define FCR_TRIGGER_14	0xc0
+
+#define RS_FIFO_TRIGGER	FCR_TRIGGER_8
+
+/*
+ * How many bytes write_char in rs_io.s may send per interrupt: 16 for a
+ * 16550A with its FIFOs on, 1 for older uarts. Indexed by tty number.
+ */
+unsigned char rs_fifo_size[3] = {1,1,1};
 
 extern void rs1_interrupt(void);
 extern void rs2_interrupt(void);
@@ -34,12 +55,33 @@ static void init(int port)
 	(void)inb(port);	/* read data port to reset things (?) */
 }
 
+/*
+ * Try to turn the FIFOs on: only a 16550A says so in the top bits of
+ * the interrupt ident register. The FIFOs of the plain 16550 don't work
+ * properly, so anything else gets them turned off again.
+ */
+static void init_fifo(int line)
+{
+	int port = tty_table[line].read_q.data;
+
+	outb_p(FCR_ENABLE | FCR_CLEAR_RCVR | FCR_CLEAR_XMIT | RS_FIFO_TRIGGER,
+		port+2);
+	if ((inb_p(port+2) & 0xc0) == 0xc0)
+		rs_fifo_size[line] = 16;
+	else {
+		outb_p(0x00,port+2);
+		rs_fifo_size[line] = 1;
+	}
+}
+
 void rs_init(void)
 {
 	set_intr_gate(0x24,rs1_interrupt);
 	set_intr_gate(0x23,rs2_interrupt);
 	init(tty_table[1].read_q.data);
 	init(tty_table[2].read_q.data);
+	init_fifo(1);
+	init_fifo(2);
 	outb(inb_p(0x21)&0xE7,0x21);
 }
 
@@ -52,8 +94,74 @@ void rs_init(void)
  */
 void rs_write(struct tty_struct * tty)
 {
+	int port = tty->write_q.data;
+	unsigned long flags;
+
+	save_flags(flags);
 	cli();
-	if (!EMPTY(tty->write_q))
-		outb(inb_p(tty->write_q.data+1)|0x02,tty->write_q.data+1);
-	sti();
+	if (tty->x_char ||
+	    (!EMPTY(tty->write_q) && !tty->stopped && !tty->hw_stopped))
+		outb(inb_p(port+1)|0x02,port+1);
+	else
+		outb(inb_p(port+1)&~0x02,port+1);
+	restore_flags(flags);
+}
+
+/*
+ * Called by tty_io.c when our input queues go over (on=1) or back
+ * under (on=0) their watermarks: tell the other side to stop or go on
+ * with XOFF/XON and/or by dropping/raising RTS. The XOFF/XON goes in
+ * x_char, which write_char sends ahead of write_q, even when we are
+ * stopped ourselves. Returns 1 if the other side has been told.
+ */
+int rs_throttle(struct tty_struct * tty, int on)
+{
+	int port = tty->read_q.data;
+	unsigned long flags;
+	int told = 0;
+
+	if (tty->termios.c_iflag & IXOFF) {
+		tty->x_char = on ? STOP_CHAR(tty) : START_CHAR(tty);
+		rs_write(tty);
+		told = 1;
+	}
+	if (tty->termios.c_cflag & CRTSCTS) {
+		save_flags(flags);
+		cli();
+		if (on)
+			outb_p(inb_p(port+4) & ~0x02,port+4);
+		else
+			outb_p(inb_p(port+4) | 0x02,port+4);
+		restore_flags(flags);
+		told = 1;
+	}
+	return told;
+}
+
+/*
+ * Called from write_char in rs_io.s when x_char has gone out: see if
+ * there is anything else we may send.
+ */
+void rs_x_char_sent(int line)
+{
+	struct tty_struct * tty = line + tty_table;
+
+	tty->x_char = 0;
+	rs_write(tty);
+}
+
+/*
+ * The modem status interrupt: with CRTSCTS, a dropped CTS stops the
+ * transmitter until it comes back.
+ */
+void rs_modem_status(int line, int status)
+{
+	struct tty_struct * tty = line + tty_table;
+
+	if (!(tty->termios.c_cflag & CRTSCTS)) {
+		tty->hw_stopped = 0;
+		return;
+	}
+	tty->hw_stopped = !(status & 0x10);
+	rs_write(tty);
 }
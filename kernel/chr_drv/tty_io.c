@@ -13,8 +13,8 @@
 #include <ctype.h>
 #include <errno.h>
 #include <signal.h>
+#include <fcntl.h>
 
-#define ALRMMASK (1<<(SIGALRM-1))
 #define KILLMASK (1<<(SIGKILL-1))
 #define INTMASK (1<<(SIGINT-1))
 #define QUITMASK (1<<(SIGQUIT-1))
@@ -22,6 +22,7 @@
 
 #include <linux/sched.h>
 #include <linux/tty.h>
+#include <linux/interrupt.h>
 #include <asm/segment.h>
 #include <asm/system.h>
 
@@ -48,21 +49,48 @@
 #define O_NLRET(tty)	_O_FLAG((tty),ONLRET)
 #define O_LCUC(tty)	_O_FLAG((tty),OLCUC)
 
-struct tty_struct tty_table[] = {
+#define I_IXON(tty)	_I_FLAG((tty),IXON)
+
+/*
+ * The queue buffers, sized per tty. The console is fed by the keyboard
+ * and drained synchronously by con_write(), so it doesn't need much;
+ * the serial lines get bigger input queues, so that there's room left
+ * for what is still coming in after the other side has been throttled.
+ */
+static char con_read_buf[NR_CONSOLES][1024];
+static char con_write_buf[NR_CONSOLES][1024];
+static char con_sec_buf[NR_CONSOLES][1024];
+static char rs1_read_buf[4096], rs1_write_buf[2048], rs1_sec_buf[4096];
+static char rs2_read_buf[4096], rs2_write_buf[2048], rs2_sec_buf[4096];
+
+#define CONSOLE(nr) \
+	{ \
+		{ICRNL,		/* change incoming CR to NL */ \
+		OPOST|ONLCR,	/* change outgoing NL to CRNL */ \
+		0, \
+		ISIG | ICANON | ECHO | ECHOCTL | ECHOKE, \
+		0,		/* console termio */ \
+		INIT_C_CC}, \
+		0,			/* initial pgrp */ \
+		0,			/* initial stopped */ \
+		0,			/* initial hw_stopped */ \
+		0,			/* initial throttled */ \
+		con_write, \
+		NULL,			/* the console can't be throttled */ \
+		0,			/* initial x_char */ \
+		TTY_QUEUE(0,con_read_buf[nr]),	/* console read-queue */ \
+		TTY_QUEUE(nr,con_write_buf[nr]),	/* console write-queue */ \
+		TTY_QUEUE(0,con_sec_buf[nr])	/* console secondary queue */ \
+	}
+
+/*
+ * The data field of a console's write queue holds its number, where the
+ * serial lines have their port (a zero port in read_q.data tells
+ * change_speed() there's no uart). The entries must match NR_CONSOLES.
+ */
+struct tty_struct tty_table[NR_TTYS] = {
+	CONSOLE(0),
 	{
-		{ICRNL,		/* change incoming CR to NL */
-		OPOST|ONLCR,	/* change outgoing NL to CRNL */
-		0,
-		ISIG | ICANON | ECHO | ECHOCTL | ECHOKE,
-		0,		/* console termio */
-		INIT_C_CC},
-		0,			/* initial pgrp */
-		0,			/* initial stopped */
-		con_write,
-		{0,0,0,0,""},		/* console read-queue */
-		{0,0,0,0,""},		/* console write-queue */
-		{0,0,0,0,""}		/* console secondary queue */
-	},{
 		{0, /* no translation */
 		0,  /* no translation */
 		B2400 | CS8,
@@ -71,10 +99,14 @@ struct tty_struct tty_table[] = {
 		INIT_C_CC},
 		0,
 		0,
+		0,
+		0,
 		rs_write,
-		{0x3f8,0,0,0,""},		/* rs 1 */
-		{0x3f8,0,0,0,""},
-		{0,0,0,0,""}
+		rs_throttle,
+		0,
+		TTY_QUEUE(0x3f8,rs1_read_buf),	/* rs 1 */
+		TTY_QUEUE(0x3f8,rs1_write_buf),
+		TTY_QUEUE(0,rs1_sec_buf)
 	},{
 		{0, /* no translation */
 		0,  /* no translation */
@@ -84,17 +116,25 @@ struct tty_struct tty_table[] = {
 		INIT_C_CC},
 		0,
 		0,
+		0,
+		0,
 		rs_write,
-		{0x2f8,0,0,0,""},		/* rs 2 */
-		{0x2f8,0,0,0,""},
-		{0,0,0,0,""}
-	}
+		rs_throttle,
+		0,
+		TTY_QUEUE(0x2f8,rs2_read_buf),	/* rs 2 */
+		TTY_QUEUE(0x2f8,rs2_write_buf),
+		TTY_QUEUE(0,rs2_sec_buf)
+	},
+	CONSOLE(1),
+	CONSOLE(2),
+	CONSOLE(3)
 };
 
 /*
  * these are the tables used by the machine code handlers.
  * you can implement pseudo-tty's or something by changing
- * them. Currently not done.
+ * them. The first two entries are the foreground console
+ * (the keyboard writes to them): change_console() moves them.
  */
 struct tty_queue * table_list[]={
 	&tty_table[0].read_q, &tty_table[0].write_q,
@@ -102,21 +142,24 @@ struct tty_queue * table_list[]={
 	&tty_table[2].read_q, &tty_table[2].write_q
 	};
 
+static void tty_bh(void * unused);
+
 void tty_init(void)
 {
+	init_bh(TTY_BH,tty_bh,NULL);
 	rs_init();
 	con_init();
 }
 
 void tty_intr(struct tty_struct * tty, int mask)
 {
-	int i;
+	struct task_struct * p;
 
 	if (tty->pgrp <= 0)
 		return;
-	for (i=0;i<NR_TASKS;i++)
-		if (task[i] && task[i]->pgrp==tty->pgrp)
-			task[i]->signal |= mask;
+	for_each_task(p)
+		if (p->pgrp==tty->pgrp)
+			post_signal(p,mask);
 }
 
 static void sleep_if_empty(struct tty_queue * queue)
@@ -127,19 +170,50 @@ static void sleep_if_empty(struct tty_queue * queue)
 	sti();
 }
 
+/*
+ * A full write queue is woken up (by rs_io.s) only once it has drained
+ * to its low watermark, so the writer can refill it in one go.
+ */
 static void sleep_if_full(struct tty_queue * queue)
 {
 	if (!FULL(*queue))
 		return;
 	cli();
-	while (!current->signal && LEFT(*queue)<128)
+	while (!current->signal && CHARS(*queue) > queue->low)
 		interruptible_sleep_on(&queue->proc_list);
 	sti();
 }
 
+/*
+ * Flow control for input: throttle the other side when the read queue
+ * or the secondary queue fills to its high watermark, let it go again
+ * when both have been read down to their low watermarks. We are only
+ * throttled if the driver could actually tell the other side.
+ */
+static void check_throttle(struct tty_struct * tty)
+{
+	if (tty->throttled || !tty->throttle)
+		return;
+	if (CHARS(tty->secondary) >= tty->secondary.high ||
+	    CHARS(tty->read_q) >= tty->read_q.high) {
+		tty->throttled = tty->throttle(tty,1);
+	}
+}
+
+static void check_unthrottle(struct tty_struct * tty)
+{
+	if (!tty->throttled)
+		return;
+	if (CHARS(tty->secondary) <= tty->secondary.low &&
+	    CHARS(tty->read_q) <= tty->read_q.low) {
+		tty->throttled = 0;
+		tty->throttle(tty,0);
+	}
+}
+
 void wait_for_keypress(void)
 {
-	sleep_if_empty(&tty_table[0].secondary);
+	sleep_if_empty(&tty_table[CONSOLE_TTY(fg_console)].secondary);
 }
 
 void copy_to_cooked(struct tty_struct * tty)
@@ -158,6 +232,18 @@ void copy_to_cooked(struct tty_struct * tty)
 			c=13;
 		if (I_UCLC(tty))
 			c=tolower(c);
+		if (I_IXON(tty) || L_CANON(tty)) {
+			if (c==STOP_CHAR(tty)) {
+				tty->stopped=1;
+				tty->write(tty);
+				continue;
+			}
+			if (c==START_CHAR(tty)) {
+				tty->stopped=0;
+				tty->write(tty);
+				continue;
+			}
+		}
 		if (L_CANON(tty)) {
 			if (c==KILL_CHAR(tty)) {
 				/* deal with killing the input line */
@@ -170,7 +256,7 @@ void copy_to_cooked(struct tty_struct * tty)
 						PUTCH(127,tty->write_q);
 						tty->write(tty);
 					}
-					DEC(tty->secondary.head);
+					DEC(tty->secondary,tty->secondary.head);
 				}
 				continue;
 			}
@@ -185,15 +271,7 @@ void copy_to_cooked(struct tty_struct * tty)
 					PUTCH(127,tty->write_q);
 					tty->write(tty);
 				}
-				DEC(tty->secondary.head);
-				continue;
-			}
-			if (c==STOP_CHAR(tty)) {
-				tty->stopped=1;
-				continue;
-			}
-			if (c==START_CHAR(tty)) {
-				tty->stopped=0;
+				DEC(tty->secondary,tty->secondary.head);
 				continue;
 			}
 		}
@@ -224,78 +302,100 @@ void copy_to_cooked(struct tty_struct * tty)
 		}
 		PUTCH(c,tty->secondary);
 	}
+	check_throttle(tty);
 	wake_up(&tty->secondary.proc_list);
 }
 
-int tty_read(unsigned channel, char * buf, int nr)
+/*
+ * With O_NONBLOCK in 'flags', tty_read() and tty_write() return what
+ * they have done so far - or -EAGAIN if that's nothing - where they
+ * would otherwise have gone to sleep.
+ */
+int tty_read(unsigned channel, char * buf, int nr, int flags)
 {
 	struct tty_struct * tty;
 	char c, * b=buf;
 	int minimum,time,flag=0;
-	long oldalarm;
+	struct timer_list timer;
 
-	if (channel>2 || nr<0) return -1;
+	if (channel>=NR_TTYS || nr<0) return -1;
 	tty = &tty_table[channel];
-	oldalarm = current->alarm;
 	time = 10L*tty->termios.c_cc[VTIME];
 	minimum = tty->termios.c_cc[VMIN];
+	timer.next = timer.prev = NULL;
+	timer.data = (unsigned long) current;
+	timer.function = process_timeout;
 	if (time && !minimum) {
 		minimum=1;
-		if (flag=(!oldalarm || time+jiffies<oldalarm))
-			current->alarm = time+jiffies;
+		flag = 1;
+		timer.expires = jiffies+time;
+		add_timer(&timer);
 	}
 	if (minimum>nr)
 		minimum=nr;
 	while (nr>0) {
-		if (flag && (current->signal & ALRMMASK)) {
-			current->signal &= ~ALRMMASK;
+		if (flag && !timer_pending(&timer))
 			break;
-		}
 		if (current->signal)
 			break;
 		if (EMPTY(tty->secondary) || (L_CANON(tty) &&
 		!tty->secondary.data && LEFT(tty->secondary)>20)) {
-			sleep_if_empty(&tty->secondary);
+			if (flags & O_NONBLOCK) {
+				del_timer(&timer);
+				return (b-buf)?(b-buf):-EAGAIN;
+			}
+			cli();
+			if (!current->signal && EMPTY(tty->secondary) &&
+			    !(flag && !timer_pending(&timer)))
+				interruptible_sleep_on(&tty->secondary.proc_list);
+			sti();
 			continue;
 		}
 		do {
 			GETCH(tty->secondary,c);
 			if (c==EOF_CHAR(tty) || c==10)
 				tty->secondary.data--;
-			if (c==EOF_CHAR(tty) && L_CANON(tty))
+			if (c==EOF_CHAR(tty) && L_CANON(tty)) {
+				del_timer(&timer);
 				return (b-buf);
+			}
 			else {
 				put_fs_byte(c,b++);
 				if (!--nr)
 					break;
 			}
 		} while (nr>0 && !EMPTY(tty->secondary));
-		if (time && !L_CANON(tty))
-			if (flag=(!oldalarm || time+jiffies<oldalarm))
-				current->alarm = time+jiffies;
-			else
-				current->alarm = oldalarm;
+		if (!EMPTY(tty->read_q))	/* secondary was full */
+			copy_to_cooked(tty);
+		check_unthrottle(tty);
+		if (time && !L_CANON(tty)) {
+			flag = 1;
+			timer.expires = jiffies+time;
+			add_timer(&timer);
+		}
 		if (L_CANON(tty)) {
 			if (b-buf)
 				break;
 		} else if (b-buf >= minimum)
 			break;
 	}
-	current->alarm = oldalarm;
+	del_timer(&timer);
 	if (current->signal && !(b-buf))
 		return -EINTR;
 	return (b-buf);
 }
 
-int tty_write(unsigned channel, char * buf, int nr)
+int tty_write(unsigned channel, char * buf, int nr, int flags)
 {
 	static cr_flag=0;
 	struct tty_struct * tty;
 	char c, *b=buf;
 
-	if (channel>2 || nr<0) return -1;
+	if (channel>=NR_TTYS || nr<0) return -1;
 	tty = channel + tty_table;
 	while (nr>0) {
+		if ((flags & O_NONBLOCK) && FULL(tty->write_q))
+			return (b-buf)?(b-buf):-EAGAIN;
 		sleep_if_full(&tty->write_q);
 		if (current->signal)
 			break;
@@ -319,12 +419,37 @@ int tty_write(unsigned channel, char * buf, int nr)
 			PUTCH(c,tty->write_q);
 		}
 		tty->write(tty);
-		if (nr>0)
-			schedule();
 	}
 	return (b-buf);
 }
 
+/*
+ * Readable is exactly when tty_read() wouldn't sleep: in canonical mode
+ * that means a whole line (or a nearly full queue).
+ */
+int tty_select(unsigned channel, int sel_type, select_table * wait)
+{
+	struct tty_struct * tty;
+
+	if (channel>=NR_TTYS)
+		return 1;
+	tty = channel + tty_table;
+	switch (sel_type) {
+		case SEL_IN:
+			if (!EMPTY(tty->secondary) && (!L_CANON(tty) ||
+			    tty->secondary.data || LEFT(tty->secondary)<=20))
+				return 1;
+			select_wait(&tty->secondary.proc_list,wait);
+			return 0;
+		case SEL_OUT:
+			if (!FULL(tty->write_q))
+				return 1;
+			select_wait(&tty->write_q.proc_list,wait);
+			return 0;
+	}
+	return 0;
+}
+
 /*
  * Jeh, sometimes I really like the 386.
  * This routine is called from an interrupt,
@@ -338,10 +463,31 @@ int tty_write(unsigned channel, char * buf, int nr)
  * I don't think we sleep here under normal circumstances
  * anyway, which is good, as the task sleeping might be
  * totally innocent.
+ *
+ * These days the interrupt only notes which tty has new input: the
+ * cooking (and echoing) is done by the tty bottom half, with
+ * interrupts enabled again.
  */
+static unsigned long tty_pending = 0;
+
 void do_tty_interrupt(int tty)
 {
-	copy_to_cooked(tty_table+tty);
+	tty_pending |= 1 << tty;
+	mark_bh(TTY_BH);
+}
+
+static void tty_bh(void * unused)
+{
+	unsigned long pending;
+	int tty;
+
+	cli();
+	pending = tty_pending;
+	tty_pending = 0;
+	sti();
+	for (tty = 0 ; pending ; tty++, pending >>= 1)
+		if (pending & 1)
+			copy_to_cooked(tty_table+tty);
 }
 
 void chr_dev_init(void)
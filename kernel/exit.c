@@ -12,24 +12,21 @@
 #include <linux/kernel.h>
 #include <linux/tty.h>
 #include <asm/segment.h>
+#include <asm/system.h>
 
 int sys_pause(void);
 int sys_close(int fd);
 
 void release(struct task_struct * p) //功能 释放对应的内存页（代码段，数据段，堆栈），清空任务队列对应项
 {
-	int i;
-
 	if (!p)
 		return;
-	for (i=1 ; i<NR_TASKS ; i++)
-		if (task[i]==p) {
-			task[i]=NULL;
-			free_page((long)p);
-			schedule();
-			return;
-		}
-	panic("trying to release non-existent task");
+	if (p->nr <= 0 || p->nr >= NR_TASKS || task[p->nr] != p)
+		panic("trying to release non-existent task");
+	unlink_task(p);
+	free_task_slot(p->nr);
+	free_page((long)p);
+	schedule();
 }
 
 static inline int send_sig(long sig,struct task_struct * p,int priv) //向某个进程发送信号
@@ -37,7 +34,7 @@ static inline int send_sig(long sig,struct task_struct * p,int priv) //向某个
 	if (!p || sig<1 || sig>32)
 		return -EINVAL;
 	if (priv || (current->euid==p->euid) || suser()) //发生信号需要满足一定的条件
-		p->signal |= (1<<(sig-1));
+		post_signal(p,1<<(sig-1));
 	else
 		return -EPERM;
 	return 0;
@@ -45,12 +42,11 @@ static inline int send_sig(long sig,struct task_struct * p,int priv) //向某个
 
 static void kill_session(void)
 {
-	struct task_struct **p = NR_TASKS + task;
-	
-	while (--p > &FIRST_TASK) {
-		if (*p && (*p)->session == current->session)
-			(*p)->signal |= 1<<(SIGHUP-1); //终止当前进程的会话，给其发送SIGHUP
-	}
+	struct task_struct *p;
+
+	for_each_task(p)
+		if (p->session == current->session)
+			post_signal(p,1<<(SIGHUP-1)); //终止当前进程的会话，给其发送SIGHUP
 }
 
 /*
@@ -59,59 +55,80 @@ static void kill_session(void)
  */
 int sys_kill(int pid,int sig) //给对应的PID发送sig,
 {
-	struct task_struct **p = NR_TASKS + task;
+	struct task_struct *p;
 	int err, retval = 0;
 
-	if (!pid) while (--p > &FIRST_TASK) { //pid =0，给当前进程组发送sig
-		if (*p && (*p)->pgrp == current->pid) 
-			if (err=send_sig(sig,*p,1))
-				retval = err;
-	} else if (pid>0) while (--p > &FIRST_TASK) {  //pid >0，给对应进程发送sig
-		if (*p && (*p)->pid == pid) 
-			if (err=send_sig(sig,*p,0))
+	if (pid>0) { //pid >0，给对应进程发送sig
+		if (!(p = find_task_by_pid(pid)) || !p->nr)
+			return 0;
+		return send_sig(sig,p,0);
+	}
+	if (!pid) { //pid =0，给当前进程组发送sig
+		for_each_task(p)
+			if (p->pgrp == current->pid)
+				if (err=send_sig(sig,p,1))
+					retval = err;
+	} else if (pid == -1) { //给所有PID发送sig
+		for_each_task(p)
+			if (err = send_sig(sig,p,0))
 				retval = err;
-	} else if (pid == -1) while (--p > &FIRST_TASK) //给所有PID发送sig
-		if (err = send_sig(sig,*p,0))
-			retval = err;
-	else while (--p > &FIRST_TASK) //给进程组号为-pid的发送sig
-		if (*p && (*p)->pgrp == -pid)
-			if (err = send_sig(sig,*p,0))
+	} else for_each_task(p) //给进程组号为-pid的发送sig
+		if (p->pgrp == -pid)
+			if (err = send_sig(sig,p,0))
 				retval = err;
 	return retval;
 }
 
-static void tell_father(int pid) //子进程向父进程发送信号
+static void tell_father(void) //子进程向父进程发送信号
 {
-	int i;
-
-	if (pid)
-		for (i=0;i<NR_TASKS;i++) {
-			if (!task[i])
-				continue;
-			if (task[i]->pid != pid)
-				continue;
-			task[i]->signal |= (1<<(SIGCHLD-1));
-			return;
-		}
+	if (current->father) {
+		post_signal(current->p_pptr,1<<(SIGCHLD-1));
+		return;
+	}
 /* if we don't find any fathers, we just release ourselves */
 /* This is not really OK. Must change it to make father 1 */
 	printk("BAD BAD - no father found\n\r");
 	release(current);  //如果没有father,自己释放此进程
 }
 
+/*
+ * Give all our children to init (task[1]), at the front of its child
+ * list. If init itself is exiting there's nobody to give them to: they
+ * are left where they are, as they always were.
+ */
+static void forget_original_parent(void)
+{
+	struct task_struct *p, *init = task[1];
+
+	if (current == init) {
+		if (current->p_cptr)
+			printk("init exiting with children left\n\r");
+		return;
+	}
+	cli();
+	while (p = current->p_cptr) {
+		current->p_cptr = p->p_osptr;
+		p->father = 1;
+		p->p_pptr = init;
+		p->p_ysptr = NULL;
+		if (p->p_osptr = init->p_cptr)
+			p->p_osptr->p_ysptr = p;
+		init->p_cptr = p;
+		if (p->state == TASK_ZOMBIE) //若存在僵尸进程，给11父进程发送sigCHILD信号
+			/* assumption task[1] is always init */
+			(void) send_sig(SIGCHLD, init, 1);
+	}
+	sti();
+}
+
 int do_exit(long code) //中断调用函数，一个系统调用
 {
 	int i;
 
 	free_page_tables(get_base(current->ldt[1]),get_limit(0x0f));//释放代码段
 	free_page_tables(get_base(current->ldt[2]),get_limit(0x17));//释放数据段
-	for (i=0 ; i<NR_TASKS ; i++)
-		if (task[i] && task[i]->father == current->pid) { //若关闭的进程有子进程，改变子进程父进程
-			task[i]->father = 1;
-			if (task[i]->state == TASK_ZOMBIE) //若存在僵尸进程，给11父进程发送sigCHILD信号
-				/* assumption task[1] is always init */
-				(void) send_sig(SIGCHLD, task[1], 1);
-		}
+	del_timer(&current->real_timer);
+	forget_original_parent(); //若关闭的进程有子进程，改变子进程父进程
 	for (i=0 ; i<NR_OPEN ; i++)
 		if (current->filp[i])
 			sys_close(i); //若当前进程打开了文件，则关闭
@@ -129,7 +146,7 @@ int do_exit(long code) //中断调用函数，一个系统调用
 		kill_session();
 	current->state = TASK_ZOMBIE; //改变当前进程状态，告诉父进程
 	current->exit_code = code;
-	tell_father(current->father);
+	tell_father();
 	schedule(); //重新调度
 	return (-1);	/* just to suppress warnings */
 }
@@ -142,38 +159,34 @@ int sys_exit(int error_code)
 int sys_waitpid(pid_t pid,unsigned long * stat_addr, int options)  //释放子进程PCB块
 {
 	int flag, code;
-	struct task_struct ** p;
+	struct task_struct * p;
 
 	verify_area(stat_addr,4);
 repeat:
 	flag=0;
-	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
-		if (!*p || *p == current)
-			continue;
-		if ((*p)->father != current->pid)
-			continue;
+	for (p = current->p_cptr ; p ; p = p->p_osptr) {
 		if (pid>0) {
-			if ((*p)->pid != pid)
+			if (p->pid != pid)
 				continue;
 		} else if (!pid) {
-			if ((*p)->pgrp != current->pgrp)
+			if (p->pgrp != current->pgrp)
 				continue;
 		} else if (pid != -1) {
-			if ((*p)->pgrp != -pid)
+			if (p->pgrp != -pid)
 				continue;
 		}
-		switch ((*p)->state) {
+		switch (p->state) {
 			case TASK_STOPPED:
 				if (!(options & WUNTRACED))
 					continue;
 				put_fs_long(0x7f,stat_addr);
-				return (*p)->pid;
+				return p->pid;
 			case TASK_ZOMBIE:
-				current->cutime += (*p)->utime;
-				current->cstime += (*p)->stime;
-				flag = (*p)->pid;
-				code = (*p)->exit_code;
-				release(*p);
+				current->cutime += p->utime;
+				current->cstime += p->stime;
+				flag = p->pid;
+				code = p->exit_code;
+				release(p);
 				put_fs_long(code,stat_addr);
 				return flag;
 			default:
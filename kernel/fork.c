@@ -74,22 +74,37 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 {
 	struct task_struct *p;
 	int i;
+	long pid = last_pid;
 	struct file *f;
 
 	p = (struct task_struct *) get_free_page();//申请一块内存空间，设置为struct task_struct *类型，现代操作系统Kalloc
-	if (!p)
+	if (!p) {
+		free_task_slot(nr);
 		return -EAGAIN;
-	task[nr] = p;//将链表指针指向申请的内存空间
+	}
+/* get_free_page() may sleep (swapping): somebody might have taken the pid */
+	if (find_task_by_pid(pid)) {
+		free_page((long) p);
+		free_task_slot(nr);
+		return -EAGAIN;
+	}
 	*p = *current;	/* NOTE! this doesn't copy the supervisor stack */
 	p->state = TASK_UNINTERRUPTIBLE;
-	p->pid = last_pid;
+	p->pid = pid;
 	p->father = current->pid;
+	p->p_pptr = current;
+	p->p_cptr = NULL;
+	p->nr = nr;
+	p->array = NULL;
+	link_task(p);//将链表指针指向申请的内存空间
 	p->counter = p->priority;
 	p->signal = 0;
-	p->alarm = 0;
+	p->real_timer.next = p->real_timer.prev = NULL;
 	p->leader = 0;		/* process leadership doesn't inherit */
 	p->utime = p->stime = 0;
 	p->cutime = p->cstime = 0;
+	p->min_flt = p->maj_flt = 0;
+	p->prof_scale = 0;	/* profil() doesn't inherit */
 	p->start_time = jiffies;
 	p->tss.back_link = 0;
 	p->tss.esp0 = PAGE_SIZE + (long) p;
@@ -115,11 +130,16 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 	if (last_task_used_math == current)
 		__asm__("clts ; fnsave %0"::"m" (p->tss.i387));
 		//将代码段与数据段拷贝到内存，并将LDT变量指向其
-	if (copy_mem(nr,p)) { 
-		task[nr] = NULL;
+	if (copy_mem(nr,p)) {
+		unlink_task(p);
+		free_task_slot(nr);
 		free_page((long) p);
 		return -EAGAIN;
 	}
+	/* copy_page_tables() write-protected our profil() buffer: do_profile()
+	   can't take the fault from the timer, so un-share it now */
+	if (current->prof_scale)
+		verify_area((void *) current->prof_buf,current->prof_size);
 	//子进程继承进程打开的文件，所以将文件的打开计数加+
 	for (i=0; i<NR_OPEN;i++)
 		if (f=p->filp[i])
@@ -132,20 +152,14 @@ int copy_process(int nr,long ebp,long edi,long esi,long gs,long none,
 		current->executable->i_count++;
 	set_tss_desc(gdt+(nr<<1)+FIRST_TSS_ENTRY,&(p->tss));
 	set_ldt_desc(gdt+(nr<<1)+FIRST_LDT_ENTRY,&(p->ldt));
-	p->state = TASK_RUNNING;	/* do this last, just in case */
-	return last_pid;
+	wake_up_process(p);	/* do this last, just in case */
+	return pid;
 }
 
 int find_empty_process(void) //找到一个空进程号
 {
-	int i;
-
-	repeat:
+	do {
 		if ((++last_pid)<0) last_pid=1;
-		for(i=0 ; i<NR_TASKS ; i++)
-			if (task[i] && task[i]->pid == last_pid) goto repeat;
-	for(i=1 ; i<NR_TASKS ; i++)
-		if (!task[i])
-			return i;
-	return -EAGAIN;
+	} while (find_task_by_pid(last_pid));
+	return alloc_task_slot();
 }
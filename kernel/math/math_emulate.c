@@ -38,5 +38,5 @@ void math_error(void)
 {
 	__asm__("fnclex");
 	if (last_task_used_math)
-		last_task_used_math->signal |= 1<<(SIGFPE-1);
+		post_signal(last_task_used_math,1<<(SIGFPE-1));
 }
@@ -8,34 +8,193 @@
  * When in kernel-mode, we cannot use printf, as fs is liable to
  * point to 'interesting' things. Make a printf with fs-saving, and
  * all is well.
+ *
+ * printk() doesn't write to the console itself: the message goes into
+ * log_buf, a ring of LOG_BUF_LEN characters, and then whatever the
+ * console hasn't seen yet is drained to it. Putting a message into the
+ * ring only needs interrupts off for a moment - it never sleeps or
+ * waits for the tty. A printk that comes in (from an interrupt, say)
+ * while the console is being written to just appends: the one that is
+ * draining sees the new text and writes it out too.
+ *
+ * The ring can be read from user space with sys_syslog(), below.
  */
 #include <stdarg.h>
 #include <stddef.h>
+#include <errno.h>
+#include <unistd.h>
+#include <string.h>
 
+#include <linux/sched.h>
 #include <linux/kernel.h>
+#include <asm/segment.h>
+#include <asm/system.h>
+
+#define LOG_BUF_LEN	4096		/* must be a power of two */
+#define LOG_MASK	(LOG_BUF_LEN-1)
 
 static char buf[1024];
 
-extern int vsprintf(char * buf, const char * fmt, va_list args);
+/*
+ * The positions are free-running counters: log_end-log_start is what
+ * syslog readers haven't had yet, log_end-con_start what the console
+ * hasn't.
+ */
+static char log_buf[LOG_BUF_LEN];
+static unsigned long log_start = 0;
+static unsigned long con_start = 0;
+static unsigned long log_end = 0;
+static unsigned long logged_chars = 0;
+static struct wait_queue * log_wait = NULL;
+static int console_busy = 0;
+static int console_off = 0;
 
-int printk(const char *fmt, ...)
-{
-	va_list args;
-	int i;
+extern int vsnprintf(char * buf, int size, const char * fmt, va_list args);
 
-	va_start(args, fmt);
-	i=vsprintf(buf,fmt,args);
-	va_end(args);
+static void console_print(const char * b, int n)
+{
 	__asm__("push %%fs\n\t"
 		"push %%ds\n\t"
 		"pop %%fs\n\t"
+		"pushl $0\n\t"
+		"pushl %1\n\t"
 		"pushl %0\n\t"
-		"pushl $_buf\n\t"
 		"pushl $0\n\t"
 		"call _tty_write\n\t"
-		"addl $8,%%esp\n\t"
-		"popl %0\n\t"
+		"addl $16,%%esp\n\t"
 		"pop %%fs"
-		::"r" (i):"ax","cx","dx");
+		::"r" (b),"r" (n):"ax","cx","dx");
+}
+
+static void console_drain(void)
+{
+	unsigned long flags;
+	unsigned long start;
+	int n;
+
+	save_flags(flags);
+	cli();
+	if (console_busy) {
+		restore_flags(flags);
+		return;
+	}
+	console_busy = 1;
+	while (con_start != log_end) {
+		if (log_end - con_start > LOG_BUF_LEN)
+			con_start = log_end - LOG_BUF_LEN;
+		start = con_start & LOG_MASK;
+		n = log_end - con_start;
+		if (n > LOG_BUF_LEN - start)
+			n = LOG_BUF_LEN - start;
+		con_start += n;
+		restore_flags(flags);
+		console_print(log_buf + start, n);
+		cli();
+	}
+	console_busy = 0;
+	restore_flags(flags);
+}
+
+int printk(const char *fmt, ...)
+{
+	va_list args;
+	unsigned long flags;
+	int i, n, end;
+
+	save_flags(flags);
+	cli();
+	va_start(args, fmt);
+	i=vsnprintf(buf,sizeof(buf),fmt,args);
+	va_end(args);
+	if (i >= sizeof(buf))
+		i = sizeof(buf)-1;
+	end = log_end & LOG_MASK;
+	n = (i < LOG_BUF_LEN - end) ? i : LOG_BUF_LEN - end;
+	memcpy(log_buf + end, buf, n);
+	memcpy(log_buf, buf + n, i - n);
+	log_end += i;
+	if (log_end - log_start > LOG_BUF_LEN)
+		log_start = log_end - LOG_BUF_LEN;
+	logged_chars += i;
+	if (logged_chars > LOG_BUF_LEN)
+		logged_chars = LOG_BUF_LEN;
+	restore_flags(flags);
+	wake_up(&log_wait);
+	if (!console_off)
+		console_drain();
 	return i;
 }
+
+/*
+ * Commands to sys_syslog(type, buf, len) - see <unistd.h>:
+ *
+ *	SYSLOG_READ		wait for messages, and take them out of the log
+ *	SYSLOG_READ_ALL		read the last 'len' characters, still in the log
+ *	SYSLOG_READ_CLEAR	the same, and then forget them
+ *	SYSLOG_CLEAR		forget what's in the log
+ *	SYSLOG_CONSOLE_OFF	stop printing messages on the console
+ *	SYSLOG_CONSOLE_ON	start again (with what's been missed)
+ *
+ * Only the superuser may do anything but SYSLOG_READ_ALL.
+ */
+int sys_syslog(int type, char * ubuf, int len)
+{
+	unsigned long j;
+	int i, count;
+	char c;
+
+	if (type != SYSLOG_READ_ALL && !suser())
+		return -EPERM;
+	switch (type) {
+		case SYSLOG_READ:
+			if (!ubuf || len < 0)
+				return -EINVAL;
+			if (!len)
+				return 0;
+			verify_area(ubuf,len);
+			cli();
+			while (log_start == log_end) {
+				if (current->signal) {
+					sti();
+					return -EINTR;
+				}
+				interruptible_sleep_on(&log_wait);
+			}
+			i = 0;
+			while (log_start != log_end && i < len) {
+				c = log_buf[log_start & LOG_MASK];
+				log_start++;
+				sti();
+				put_fs_byte(c,ubuf++);
+				i++;
+				cli();
+			}
+			sti();
+			return i;
+		case SYSLOG_READ_ALL:
+		case SYSLOG_READ_CLEAR:
+			if (!ubuf || len < 0)
+				return -EINVAL;
+			verify_area(ubuf,len);
+			count = len;
+			if (count > logged_chars)
+				count = logged_chars;
+			j = log_end - count;
+			for (i = 0 ; i < count ; i++)
+				put_fs_byte(log_buf[(j+i) & LOG_MASK],ubuf++);
+			if (type == SYSLOG_READ_CLEAR)
+				logged_chars = 0;
+			return count;
+		case SYSLOG_CLEAR:
+			logged_chars = 0;
+			return 0;
+		case SYSLOG_CONSOLE_OFF:
+			console_off = 1;
+			return 0;
+		case SYSLOG_CONSOLE_ON:
+			console_off = 0;
+			console_drain();
+			return 0;
+	}
+	return -EINVAL;
+}
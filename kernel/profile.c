@@ -0,0 +1,136 @@
+/*
+ *  linux/kernel/profile.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * profile.c looks at where the cpu is on every clock tick: do_timer()
+ * hands do_profile() the eip it interrupted. That's HZ samples a second
+ * (ticks that are skipped while idle aren't sampled, but then there is
+ * nothing to see anyway).
+ *
+ * In user mode the sample goes to the process, if it has asked for it
+ * with profil() - sys_prof() below. In kernel mode it goes to
+ * prof_buffer, which has a counter for every 1<<prof_shift bytes of
+ * kernel text. prof_buffer is only there if the kernel was built with
+ * PROFILE (see the Makefile): main() then has prof_init() set aside the
+ * memory for it. It can be read as /proc/profile - the counters are
+ * never cleared, so take the difference of two reads.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/segment.h>
+
+unsigned long * prof_buffer = NULL;
+unsigned long prof_len = 0;
+int prof_shift = 0;
+
+/*
+ * Returns the memory used, which main() takes off the start of main
+ * memory, as with the ramdisk.
+ */
+long prof_init(long mem_start, int shift)
+{
+	extern int etext;
+	long size;
+
+	prof_shift = shift;
+	prof_len = (((unsigned long) &etext) >> shift) + 1;
+	size = prof_len * sizeof(unsigned long);
+	prof_buffer = (unsigned long *) mem_start;
+	memset(prof_buffer,0,size);
+	return (size + 4095) & 0xfffff000;
+}
+
+/*
+ * We can't take a page fault in the timer interrupt: a user counter
+ * that isn't mapped writable just now loses the sample.
+ */
+static int writable(unsigned long addr)
+{
+	unsigned long page;
+
+	page = *(unsigned long *) ((addr >> 20) & 0xffc);
+	if (!(page & PAGE_PRESENT))
+		return 0;
+	page = ((unsigned long *) (page & 0xfffff000))[(addr >> 12) & 0x3ff];
+	return (page & (PAGE_PRESENT | PAGE_RW)) == (PAGE_PRESENT | PAGE_RW);
+}
+
+/*
+ * The counter is ((eip-offset)/2 * scale) / 65536. eip is an offset in
+ * the 64MB user segment, so this doesn't overflow as long as scale is at
+ * most 0x10000.
+ */
+static void user_tick(unsigned long eip)
+{
+	unsigned long i, addr;
+
+	if (eip < current->prof_off)
+		return;
+	i = (eip - current->prof_off) >> 1;
+	i = (i >> 16) * current->prof_scale +
+		(((i & 0xffff) * current->prof_scale) >> 16);
+	if (i >= current->prof_size >> 1)
+		return;
+	addr = current->prof_buf + (i << 1);
+	if (!writable(get_base(current->ldt[2]) + addr))
+		return;
+	put_fs_word(get_fs_word((unsigned short *) addr) + 1,
+		(short *) addr);
+}
+
+/* called from do_timer(), with fs pointing to user space */
+void do_profile(long cpl, unsigned long eip)
+{
+	if (cpl) {
+		if (current->prof_scale)
+			user_tick(eip);
+		return;
+	}
+	if (!prof_buffer)
+		return;
+	eip >>= prof_shift;
+	if (eip >= prof_len)
+		eip = prof_len-1;
+	prof_buffer[eip]++;
+}
+
+/*
+ * sys_prof() is profil(): from now on, every tick that finds us in
+ * user mode at 'eip' adds one to the unsigned short
+ *
+ *	buf[((eip-offset)/2 * scale) / 65536]
+ *
+ * if that is within the 'size' bytes of buf. A scale of 0x10000 gives
+ * every two bytes of text a counter, 0x8000 every four, and so on. A
+ * scale of 0 or 1 turns profiling off. The child of a fork() isn't
+ * profiled, and exec() turns profiling off.
+ */
+int sys_prof(unsigned short * buf, unsigned long size, unsigned long offset,
+	unsigned int scale)
+{
+	if (scale < 2) {
+		current->prof_scale = 0;
+		return 0;
+	}
+	if (scale > 0x10000 || ((unsigned long) buf & 1))
+		return -EINVAL;
+	size &= ~1;
+	if ((unsigned long) buf + size < (unsigned long) buf ||
+	    (unsigned long) buf + size > get_limit(0x17))
+		return -EFAULT;
+	verify_area(buf,size);
+	current->prof_scale = 0;
+	current->prof_buf = (unsigned long) buf;
+	current->prof_size = size;
+	current->prof_off = offset;
+	current->prof_scale = scale;
+	return 0;
+}
@@ -13,12 +13,14 @@
 #include <linux/sched.h>
 #include <linux/kernel.h>
 #include <linux/sys.h>
+#include <linux/interrupt.h>
 #include <linux/fdreg.h>
 #include <asm/system.h>
 #include <asm/io.h>
 #include <asm/segment.h>
 
 #include <signal.h>
+#include <errno.h>
 
 #define _S(nr) (1<<((nr)-1))
 #define _BLOCKABLE (~(_S(SIGKILL) | _S(SIGSTOP)))
@@ -36,11 +38,11 @@ void show_task(int nr,struct task_struct * p)
 
 void show_stat(void)
 {
-	int i;
+	struct task_struct * p;
 
-	for (i=0;i<NR_TASKS;i++)
-		if (task[i])
-			show_task(i,task[i]);
+	show_task(0,FIRST_TASK);
+	for_each_task(p)
+		show_task(p->nr,p);
 }
 
 #define LATCH (1193180/HZ)
@@ -63,6 +65,75 @@ struct task_struct *current = &(init_task.task);
 struct task_struct *last_task_used_math = NULL;
 
 struct task_struct * task[NR_TASKS] = {&(init_task.task), };
+struct task_struct * pidhash[PIDHASH_SZ];
+
+/*
+ * The free slots in task[] (and so in the gdt and the linear address
+ * space) are kept on a stack, so that fork doesn't have to search.
+ */
+static int free_slots[NR_TASKS];
+static int nr_free_slots = 0;
+
+int alloc_task_slot(void)
+{
+	if (!nr_free_slots)
+		return -EAGAIN;
+	return free_slots[--nr_free_slots];
+}
+
+void free_task_slot(int nr)
+{
+	if (nr <= 0 || nr >= NR_TASKS || task[nr])
+		panic("free_task_slot: bad slot");
+	free_slots[nr_free_slots++] = nr;
+}
+
+/*
+ * link_task() puts a new task on the task list, in the pid hash and on
+ * the child list of its parent; unlink_task() takes it off them all
+ * again. The parent of a task is always on the task list.
+ */
+void link_task(struct task_struct * p)
+{
+	struct task_struct ** h = &pidhash[pid_hashfn(p->pid)];
+
+	cli();
+	p->next_task = FIRST_TASK;
+	p->prev_task = FIRST_TASK->prev_task;
+	FIRST_TASK->prev_task->next_task = p;
+	FIRST_TASK->prev_task = p;
+	p->pidhash_next = *h;
+	*h = p;
+	p->p_ysptr = NULL;
+	if (p->p_osptr = p->p_pptr->p_cptr)
+		p->p_osptr->p_ysptr = p;
+	p->p_pptr->p_cptr = p;
+	task[p->nr] = p;
+	sti();
+}
+
+void unlink_task(struct task_struct * p)
+{
+	struct task_struct ** h = &pidhash[pid_hashfn(p->pid)];
+
+	cli();
+	p->next_task->prev_task = p->prev_task;
+	p->prev_task->next_task = p->next_task;
+	while (*h != p) {
+		if (!*h)
+			panic("pid hash corrupted");
+		h = &(*h)->pidhash_next;
+	}
+	*h = p->pidhash_next;
+	if (p->p_osptr)
+		p->p_osptr->p_ysptr = p->p_ysptr;
+	if (p->p_ysptr)
+		p->p_ysptr->p_osptr = p->p_osptr;
+	else
+		p->p_pptr->p_cptr = p->p_osptr;
+	task[p->nr] = NULL;
+	sti();
+}
 
 long user_stack [ PAGE_SIZE>>2 ] ;
 
@@ -91,6 +162,148 @@ void math_state_restore() //协处理器恢复函数，实现协处理器的切
 	}
 }
 
+/*
+ * The run queues. The scheduling policy is still the old one: run the
+ * runnable task with the largest counter, and when all runnable tasks
+ * have used up their counters, give every task counter/2 + priority,
+ * so that tasks that have been sleeping (IO-bound ones) get more.
+ *
+ * Runnable tasks other than the current one are kept in an array of
+ * queues indexed by counter, with a bitmap of the non-empty ones, so
+ * that finding the best one is a bit scan. Tasks that have used up
+ * their counter go on a second, 'expired' array (with their counter
+ * already refilled), and the two are swapped when the active one runs
+ * dry. Sleeping tasks aren't touched at that time: every swap is an
+ * epoch, and a task catches up with the epochs it slept through when
+ * it is woken up.
+ */
+#define NR_PRIO 64
+
+struct prio_array {
+	int nr_active;
+	unsigned long bitmap[NR_PRIO/32];
+	struct task_struct * queue[NR_PRIO];
+};
+
+static struct prio_array arrays[2];
+static struct prio_array * active = arrays;
+static struct prio_array * expired = arrays+1;
+static long sched_epoch = 0;
+
+static inline int prio_index(long counter)
+{
+	return (counter >= NR_PRIO) ? NR_PRIO-1 : counter;
+}
+
+static void enqueue_task(struct task_struct * p, struct prio_array * array)
+{
+	struct task_struct ** q = &array->queue[prio_index(p->counter)];
+	int i = prio_index(p->counter);
+
+	if (*q) {
+		p->run_next = *q;
+		p->run_prev = (*q)->run_prev;
+		(*q)->run_prev->run_next = p;
+		(*q)->run_prev = p;
+	} else {
+		*q = p->run_next = p->run_prev = p;
+		array->bitmap[i>>5] |= 1 << (i & 31);
+	}
+	p->array = array;
+	array->nr_active++;
+}
+
+static void dequeue_task(struct task_struct * p)
+{
+	struct prio_array * array = p->array;
+	int i = prio_index(p->counter);
+
+	if (p->run_next == p) {
+		array->queue[i] = NULL;
+		array->bitmap[i>>5] &= ~(1 << (i & 31));
+	} else {
+		p->run_next->run_prev = p->run_prev;
+		p->run_prev->run_next = p->run_next;
+		if (array->queue[i] == p)
+			array->queue[i] = p->run_next;
+	}
+	p->array = NULL;
+	array->nr_active--;
+}
+
+/*
+ * Put a runnable task on the run queue. Must be called with interrupts
+ * off.
+ */
+static void activate_task(struct task_struct * p)
+{
+	int i;
+
+	for (i = 0 ; p->epoch != sched_epoch && i < 32 ; i++) {
+		p->counter = (p->counter >> 1) + p->priority;
+		p->epoch++;
+	}
+	p->epoch = sched_epoch;
+	if (p->counter > 0) {
+		enqueue_task(p,active);
+		return;
+	}
+	p->counter = p->priority;
+	p->epoch = sched_epoch+1;
+	enqueue_task(p,expired);
+}
+
+static struct task_struct * pick_next_task(void)
+{
+	struct prio_array * array;
+	struct task_struct * p;
+	int i,bit;
+
+	if (!active->nr_active) {
+		if (!expired->nr_active)
+			return FIRST_TASK;
+		array = active;
+		active = expired;
+		expired = array;
+		sched_epoch++;
+	}
+	for (i = NR_PRIO/32 ; i-- > 0 ; )
+		if (active->bitmap[i])
+			break;
+	__asm__("bsrl %1,%0":"=r" (bit):"r" (active->bitmap[i]));
+	p = active->queue[(i<<5) + bit];
+	dequeue_task(p);
+	return p;
+}
+
+/*
+ * wake_up_process() makes a task runnable. This can be called from
+ * interrupts.
+ */
+void wake_up_process(struct task_struct * p)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	p->state = TASK_RUNNING;
+	if (!p->array && p != current && p != FIRST_TASK)
+		activate_task(p);
+	restore_flags(flags);
+}
+
+/*
+ * post_signal() sends the signals in 'mask' to a task, and wakes it up
+ * if it is sleeping interruptibly and can take one of them.
+ */
+void post_signal(struct task_struct * p, long mask)
+{
+	p->signal |= mask;
+	if (p->state == TASK_INTERRUPTIBLE &&
+	    (p->signal & ~(_BLOCKABLE & p->blocked)))
+		wake_up_process(p);
+}
+
 /*
  *  'schedule()' is the scheduler function. This is GOOD CODE! There
  * probably won't be any reason to change this, as it should work well
@@ -103,94 +316,174 @@ void math_state_restore() //协处理器恢复函数，实现协处理器的切
  */
 void schedule(void) //进程调度函数
 {
-	int i,next,c;
-	struct task_struct ** p;
-
-/* check alarm, wake up any interruptible tasks that have got a signal */
-//检查时钟信号，同时判断进程是否接收到其他信号
-	for(p = &LAST_TASK ; p > &FIRST_TASK ; --p)  //
-		if (*p) {
-			if ((*p)->alarm && (*p)->alarm < jiffies) {
-					(*p)->signal |= (1<<(SIGALRM-1));
-					(*p)->alarm = 0;
-				}
-			if (((*p)->signal & ~(_BLOCKABLE & (*p)->blocked)) &&
-			(*p)->state==TASK_INTERRUPTIBLE)
-				(*p)->state=TASK_RUNNING;
-		}
+	struct task_struct * p;
+	unsigned long flags;
+
+	if (bh_active & bh_mask)
+		do_bottom_half();
 
 /* this is the scheduler proper: */
 //调度算法，Linux中最美程序之一，时间片优先轮转算法
-	while (1) {
-		c = -1;
-		next = 0;
-		i = NR_TASKS;
-		p = &task[NR_TASKS];
-		while (--i) {
-			if (!*--p)
-				continue;
-			if ((*p)->state == TASK_RUNNING && (*p)->counter > c)
-				c = (*p)->counter, next = i;
-		}
-		if (c) break; //如果当前进程中还有时间片没有用完，退出循环
-		for(p = &LAST_TASK ; p > &FIRST_TASK ; --p) //若时间片全部用完，重新分配时间片 
-			if (*p)
-				(*p)->counter = ((*p)->counter >> 1) +
-						(*p)->priority;
-	}
-	switch_to(next);
+	save_flags(flags);
+	cli();
+	if (current->state == TASK_INTERRUPTIBLE &&
+	    (current->signal & ~(_BLOCKABLE & current->blocked)))
+		current->state = TASK_RUNNING;
+	if (current != FIRST_TASK && current->state == TASK_RUNNING)
+		activate_task(current);
+	p = pick_next_task();
+	switch_to(p->nr);
+	restore_flags(flags);
 }
 
+static void cpu_idle(void);
+
 int sys_pause(void)
 {
 	current->state = TASK_INTERRUPTIBLE;
 	schedule();
+	if (current == FIRST_TASK)
+		cpu_idle();
 	return 0;
 }
 
-void sleep_on(struct task_struct **p) //当某个进程访问Cpu资源时，CPU资源被占用，调用其将进程休眠
+/*
+ * Non-exclusive waiters go at the front of the queue, exclusive ones at
+ * the back, so wake_up_one() can stop at the first exclusive waiter it
+ * wakes.
+ */
+static inline void add_wait_queue(struct wait_queue ** p,
+	struct wait_queue * wait)
+{
+	if (!wait->exclusive || !*p) {
+		wait->next = *p;
+		*p = wait;
+		return;
+	}
+	while ((*p)->next)
+		p = &(*p)->next;
+	wait->next = NULL;
+	(*p)->next = wait;
+}
+
+static inline void remove_wait_queue(struct wait_queue ** p,
+	struct wait_queue * wait)
 {
-	struct task_struct *tmp;
+	while (*p != wait) {
+		if (!*p)
+			panic("wait queue corrupted");
+		p = &(*p)->next;
+	}
+	*p = wait->next;
+}
+
+static void __sleep_on(struct wait_queue ** p, int state, int exclusive)
+{
+	struct wait_queue wait;
+	unsigned long flags;
 
 	if (!p)
 		return;
 	if (current == &(init_task.task)) //当前进程为0号进程，返回错误
 		panic("task[0] trying to sleep");
-	tmp = *p; //等待队列的实现，注意current为全局变量
-	*p = current;
-	current->state = TASK_UNINTERRUPTIBLE;//将当前进程设置为深度睡眠
+	wait.task = current; //等待队列的实现，注意current为全局变量
+	wait.exclusive = exclusive;
+	save_flags(flags);
+	cli();
+	add_wait_queue(p,&wait);
+	current->state = state;
 	schedule();//重新调度
-	if (tmp)
-		tmp->state=0;
+	remove_wait_queue(p,&wait);
+	restore_flags(flags);
 }
 
-void interruptible_sleep_on(struct task_struct **p)
+void sleep_on(struct wait_queue ** p) //当某个进程访问Cpu资源时，CPU资源被占用，调用其将进程休眠
 {
-	struct task_struct *tmp;
+	__sleep_on(p,TASK_UNINTERRUPTIBLE,0);
+}
 
-	if (!p)
+void sleep_on_exclusive(struct wait_queue ** p)
+{
+	__sleep_on(p,TASK_UNINTERRUPTIBLE,1);
+}
+
+void interruptible_sleep_on(struct wait_queue ** p)
+{
+	__sleep_on(p,TASK_INTERRUPTIBLE,0);
+}
+
+void select_wait(struct wait_queue ** wait_address, select_table * p)
+{
+	struct select_table_entry * entry;
+	unsigned long flags;
+
+	if (!p || !wait_address || p->nr >= MAX_SELECT_TABLE_ENTRIES)
 		return;
-	if (current == &(init_task.task))
-		panic("task[0] trying to sleep");
-	tmp=*p;
-	*p=current;
-repeat:	current->state = TASK_INTERRUPTIBLE;
-	schedule();
-	if (*p && *p != current) {
-		(**p).state=0;
-		goto repeat;
+	entry = p->entry + p->nr;
+	entry->wait_address = wait_address;
+	entry->wait.task = current;
+	entry->wait.exclusive = 0;
+	save_flags(flags);
+	cli();
+	add_wait_queue(wait_address,&entry->wait);
+	restore_flags(flags);
+	p->nr++;
+}
+
+void free_wait(select_table * p)
+{
+	struct select_table_entry * entry = p->entry + p->nr;
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	while (p->nr > 0) {
+		p->nr--;
+		entry--;
+		remove_wait_queue(entry->wait_address,&entry->wait);
 	}
-	*p=NULL;
-	if (tmp)
-		tmp->state=0;
+	restore_flags(flags);
 }
 
-void wake_up(struct task_struct **p)
+/*
+ * An exclusive waiter that has been woken but hasn't run yet still is
+ * on the queue: skip it, or two wake_up_one()s would only wake one
+ * task.
+ */
+void wake_up_one(struct wait_queue ** p)
 {
-	if (p && *p) {
-		(**p).state=0;
-		*p=NULL;
+	struct wait_queue * wait;
+	unsigned long flags;
+
+	if (!p)
+		return;
+	save_flags(flags);
+	cli();
+	for (wait = *p ; wait ; wait = wait->next) {
+		if (!wait->exclusive) {
+			wake_up_process(wait->task);
+			continue;
+		}
+		if (wait->task->state == TASK_RUNNING)
+			continue;
+		wake_up_process(wait->task);
+		break;
 	}
+	restore_flags(flags);
+}
+
+void wake_up_all(struct wait_queue ** p)
+{
+	struct wait_queue * wait;
+	unsigned long flags;
+
+	if (!p)
+		return;
+	save_flags(flags);
+	cli();
+	for (wait = *p ; wait ; wait = wait->next)
+		wake_up_process(wait->task);
+	restore_flags(flags);
 }
 
 /*
@@ -198,7 +491,7 @@ void wake_up(struct task_struct **p)
  * proper. They are here because the floppy needs a timer, and this
  * was the easiest way of doing it.
  */
-static struct task_struct * wait_motor[4] = {NULL,NULL,NULL,NULL};
+static struct wait_queue * wait_motor[4] = {NULL,NULL,NULL,NULL};
 static int  mon_timer[4]={0,0,0,0};
 static int moff_timer[4]={0,0,0,0};
 unsigned char current_DOR = 0x0C;
@@ -261,52 +554,306 @@ void do_floppy_timer(void)
 	}
 }
 
-#define TIME_REQUESTS 64
+/*
+ * The timer wheel. The timers due in the next 256 ticks are hashed by
+ * expiry time into tv1, one list per tick; timers further away go into
+ * one of the coarser vectors tv2-tv5, by the next 6 bits of their
+ * expiry time each. Whenever tv1 has gone all the way round, the next
+ * slot of tv2 is redistributed ("cascaded") over tv1, and so on up.
+ * Adding and deleting a timer is O(1), and running them costs O(1)
+ * per tick plus the cascades.
+ */
+#define TVN_BITS 6
+#define TVR_BITS 8
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVR_MASK (TVR_SIZE - 1)
+
+struct timer_vec {
+	int index;
+	struct timer_list vec[TVN_SIZE];
+};
+
+struct timer_vec_root {
+	int index;
+	struct timer_list vec[TVR_SIZE];
+};
+
+static struct timer_vec tv5, tv4, tv3, tv2;
+static struct timer_vec_root tv1;
+
+static struct timer_vec * const tvecs[] = {
+	(struct timer_vec *) &tv1, &tv2, &tv3, &tv4, &tv5
+};
+
+#define NOOF_TVECS (sizeof(tvecs) / sizeof(tvecs[0]))
+
+static unsigned long timer_jiffies = 0;
+
+static inline void insert_timer(struct timer_list * timer,
+	struct timer_list * head)
+{
+	timer->next = head;
+	timer->prev = head->prev;
+	head->prev->next = timer;
+	head->prev = timer;
+}
+
+static inline void detach_timer(struct timer_list * timer)
+{
+	timer->next->prev = timer->prev;
+	timer->prev->next = timer->next;
+	timer->next = timer->prev = NULL;
+}
+
+static void internal_add_timer(struct timer_list * timer)
+{
+	unsigned long expires = timer->expires;
+	unsigned long idx = expires - timer_jiffies;
+	struct timer_list * head;
+
+	if ((long) idx < 0)
+		head = tv1.vec + tv1.index;	/* already due: next tick */
+	else if (idx < TVR_SIZE)
+		head = tv1.vec + (expires & TVR_MASK);
+	else if (idx < 1 << (TVR_BITS + TVN_BITS))
+		head = tv2.vec + ((expires >> TVR_BITS) & TVN_MASK);
+	else if (idx < 1 << (TVR_BITS + 2 * TVN_BITS))
+		head = tv3.vec + ((expires >> (TVR_BITS + TVN_BITS)) & TVN_MASK);
+	else if (idx < 1 << (TVR_BITS + 3 * TVN_BITS))
+		head = tv4.vec + ((expires >> (TVR_BITS + 2 * TVN_BITS)) & TVN_MASK);
+	else
+		head = tv5.vec + ((expires >> (TVR_BITS + 3 * TVN_BITS)) & TVN_MASK);
+	insert_timer(timer,head);
+}
+
+void add_timer(struct timer_list * timer)
+{
+	unsigned long flags;
+
+	save_flags(flags);
+	cli();
+	if (timer->next)
+		detach_timer(timer);
+	internal_add_timer(timer);
+	restore_flags(flags);
+}
+
+/*
+ * Returns 1 if the timer was still pending.
+ */
+int del_timer(struct timer_list * timer)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	save_flags(flags);
+	cli();
+	if (timer->next) {
+		detach_timer(timer);
+		ret = 1;
+	}
+	restore_flags(flags);
+	return ret;
+}
+
+static void cascade_timers(struct timer_vec * tv)
+{
+	struct timer_list * head = tv->vec + tv->index;
+	struct timer_list * timer;
+
+	while ((timer = head->next) != head) {
+		detach_timer(timer);
+		internal_add_timer(timer);
+	}
+	tv->index = (tv->index + 1) & TVN_MASK;
+}
+
+/*
+ * Run everything that is due up to and including 'jiffies'. Called from
+ * the timer interrupt, with interrupts off.
+ */
+static void run_timer_list(void)
+{
+	struct timer_list * head, * timer;
+	void (*fn)(unsigned long);
+	unsigned long data;
+	int n;
+
+	while ((long) (jiffies - timer_jiffies) >= 0) {
+		if (!tv1.index) {
+			n = 1;
+			do {
+				cascade_timers(tvecs[n]);
+			} while (tvecs[n]->index == 1 && ++n < NOOF_TVECS);
+		}
+		head = tv1.vec + tv1.index;
+		while ((timer = head->next) != head) {
+			fn = timer->function;
+			data = timer->data;
+			detach_timer(timer);
+			fn(data);
+		}
+		++timer_jiffies;
+		tv1.index = (tv1.index + 1) & TVR_MASK;
+	}
+}
+
+static void init_timers(void)
+{
+	struct timer_list * head;
+	int i,n;
+
+	for (i = 0 ; i < TVR_SIZE ; i++) {
+		head = tv1.vec + i;
+		head->next = head->prev = head;
+	}
+	for (n = 1 ; n < NOOF_TVECS ; n++)
+		for (i = 0 ; i < TVN_SIZE ; i++) {
+			head = tvecs[n]->vec + i;
+			head->next = head->prev = head;
+		}
+}
+
+/*
+ * A timer function for those who just want to be woken up: 'data' is
+ * the task.
+ */
+void process_timeout(unsigned long data)
+{
+	wake_up_process((struct task_struct *) data);
+}
+
+/*
+ * Tickless idle. When task 0 finds nothing to run, it halts the cpu
+ * until the next interrupt. If no timer is due on the next tick, the
+ * PIT is first switched to one-shot mode (mode 0) and set to go off
+ * when the first timer is due; at most MAX_IDLE_TICKS ticks, as the
+ * counter only has 16 bits. do_timer() adds the ticks that were
+ * skipped to jiffies.
+ *
+ * The one-shot keeps to the tick boundaries: it starts with what's left
+ * of the current tick. If some other interrupt wakes us up first, the
+ * whole ticks that have gone by are read back from the counter, and a
+ * one-shot is set for the rest of the tick we're in - when that goes
+ * off, we are back to periodic. This way no part of a tick is lost,
+ * however many interrupts there are while idle. The periodic timer is
+ * in mode 2 rather than 3 for this: it counts down by one, so reading
+ * it tells how much of the tick is left.
+ */
+#define MAX_IDLE_TICKS (0xffff/LATCH)
+
+extern int beepcount;
+static int idle_ticks = 0;		/* ticks the one-shot stands for */
+static unsigned int idle_count = 0;	/* and what it was loaded with */
+
+static void set_periodic_timer(void)
+{
+	outb_p(0x34,0x43);		/* binary, mode 2, LSB/MSB, ch 0 */
+	outb_p(LATCH & 0xff , 0x40);	/* LSB */
+	outb(LATCH >> 8 , 0x40);	/* MSB */
+}
+
+static void set_oneshot_timer(unsigned int count)
+{
+	outb_p(0x30,0x43);		/* binary, mode 0, LSB/MSB, ch 0 */
+	outb_p(count & 0xff , 0x40);
+	outb(count >> 8 , 0x40);
+}
+
+static unsigned int read_timer(void)
+{
+	unsigned int count;
 
-static struct timer_list {
-	long jiffies;
-	void (*fn)();
-	struct timer_list * next;
-} timer_list[TIME_REQUESTS], * next_timer = NULL;
+	outb_p(0x00,0x43);		/* latch counter 0 */
+	count = inb_p(0x40);
+	count |= inb_p(0x40) << 8;
+	return count;
+}
 
-void add_timer(long jiffies, void (*fn)(void))
+/* is there a timer interrupt waiting for us? */
+static int tick_pending(void)
+{
+	outb_p(0x0a,0x20);		/* read the IRR */
+	return inb_p(0x20) & 1;
+}
+
+/*
+ * How many ticks until the timer wheel has something to do: a timer
+ * that expires, or tv1 going round (which means a cascade).
+ */
+static int next_timer_ticks(void)
 {
-	struct timer_list * p;
+	int i,idx;
+
+	if ((long) (jiffies - timer_jiffies) >= 0)
+		return 1;
+	for (i = 0 ; i < MAX_IDLE_TICKS ; i++) {
+		idx = (tv1.index + i) & TVR_MASK;
+		if (!idx || tv1.vec[idx].next != tv1.vec + idx)
+			return i+1;
+	}
+	return MAX_IDLE_TICKS;
+}
 
-	if (!fn)
+/* called with interrupts off, when something else woke us up */
+static void stop_idle_timer(void)
+{
+	unsigned int count;
+	int ticks;
+
+	count = read_timer();
+/* if it has wrapped, it's gone off, and that interrupt is still pending */
+	if (!count || count > idle_count) {
+		jiffies += idle_ticks - 1;
+		idle_ticks = 0;
+		set_periodic_timer();
 		return;
+	}
+	ticks = (count + LATCH - 1) / LATCH;	/* to go, this one included */
+	jiffies += idle_ticks - ticks;
+	idle_ticks = 1;
+	idle_count = (count - 1) % LATCH + 1;
+	set_oneshot_timer(idle_count);
+}
+
+static void cpu_idle(void)
+{
+	unsigned int left;
+	int ticks;
+
 	cli();
-	if (jiffies <= 0)
-		(fn)();
-	else {
-		for (p = timer_list ; p < timer_list + TIME_REQUESTS ; p++)
-			if (!p->fn)
-				break;
-		if (p >= timer_list + TIME_REQUESTS)
-			panic("No more time requests free");
-		p->fn = fn;
-		p->jiffies = jiffies;
-		p->next = next_timer;
-		next_timer = p;
-		while (p->next && p->next->jiffies < p->jiffies) {
-			p->jiffies -= p->next->jiffies;
-			fn = p->fn;
-			p->fn = p->next->fn;
-			p->next->fn = fn;
-			jiffies = p->jiffies;
-			p->jiffies = p->next->jiffies;
-			p->next->jiffies = jiffies;
-			p = p->next;
+	if (active->nr_active || expired->nr_active || (bh_active & bh_mask)) {
+		sti();
+		return;
+	}
+	if (!beepcount && !(current_DOR & 0xf0) &&
+	    (ticks = next_timer_ticks()) > 1) {
+		left = read_timer();
+		if (left && left <= LATCH && !tick_pending()) {
+			idle_ticks = ticks;
+			idle_count = left + (ticks-1)*LATCH;
+			set_oneshot_timer(idle_count);
 		}
 	}
+	__asm__ __volatile__("sti ; hlt");
+	cli();
+	if (idle_ticks)
+		stop_idle_timer();
 	sti();
 }
 
-void do_timer(long cpl)
+void do_timer(long cpl, unsigned long eip)
 {
-	extern int beepcount;
 	extern void sysbeepstop(void);
+	extern void do_profile(long cpl, unsigned long eip);
 
+	if (idle_ticks) {
+		jiffies += idle_ticks - 1;	/* the asm did one */
+		idle_ticks = 0;
+		set_periodic_timer();
+	}
 	if (beepcount)
 		if (!--beepcount)
 			sysbeepstop();
@@ -315,18 +862,9 @@ void do_timer(long cpl)
 		current->utime++;
 	else
 		current->stime++;
+	do_profile(cpl,eip);
 
-	if (next_timer) {
-		next_timer->jiffies--;
-		while (next_timer && next_timer->jiffies <= 0) {
-			void (*fn)(void);
-			
-			fn = next_timer->fn;
-			next_timer->fn = NULL;
-			next_timer = next_timer->next;
-			(fn)();
-		}
-	}
+	run_timer_list();
 	if (current_DOR & 0xf0)
 		do_floppy_timer();
 	if ((--current->counter)>0) return; //判断此进程时间片是否用完，没有则返回，用完则进行重新调度
@@ -335,13 +873,24 @@ void do_timer(long cpl)
 	schedule();
 }
 
-int sys_alarm(long seconds)
+static void it_real_fn(unsigned long data)
 {
-	int old = current->alarm;
+	post_signal((struct task_struct *) data,1<<(SIGALRM-1));
+}
 
-	if (old)
-		old = (old - jiffies) / HZ;
-	current->alarm = (seconds>0)?(jiffies+HZ*seconds):0;
+int sys_alarm(long seconds)
+{
+	struct timer_list * timer = &current->real_timer;
+	int old = 0;
+
+	if (del_timer(timer))
+		old = (long) (timer->expires - jiffies) / HZ;
+	if (seconds > 0) {
+		timer->expires = jiffies+HZ*seconds;
+		timer->data = (unsigned long) current;
+		timer->function = it_real_fn;
+		add_timer(timer);
+	}
 	return (old);
 }
 
@@ -399,13 +948,15 @@ void sched_init(void)
 		p->a=p->b=0;
 		p++;
 	}
+	for(i=NR_TASKS-1;i>0;i--)
+		free_slots[nr_free_slots++] = i;
+	pidhash[pid_hashfn(0)] = &(init_task.task);
+	init_timers();
 /* Clear NT, so that we won't have troubles with that later on */
 	__asm__("pushfl ; andl $0xffffbfff,(%esp) ; popfl");
 	ltr(0);
 	lldt(0);
-	outb_p(0x36,0x43);		/* binary, mode 3, LSB/MSB, ch 0 */
-	outb_p(LATCH & 0xff , 0x40);	/* LSB */
-	outb(LATCH >> 8 , 0x40);	/* MSB */
+	set_periodic_timer();
 	set_intr_gate(0x20,&timer_interrupt);
 	outb(inb_p(0x21)&~0x01,0x21);
 	set_system_gate(0x80,&system_call);
@@ -0,0 +1,41 @@
+/*
+ *  linux/kernel/softirq.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * do_bottom_half() runs the bottom halves that interrupt handlers have
+ * marked (see <linux/interrupt.h>). It is called from ret_from_sys_call
+ * when going back to user mode, and from schedule(), so the kernel code
+ * that got interrupted is never in the middle of something.
+ */
+#include <linux/interrupt.h>
+#include <asm/system.h>
+
+unsigned long bh_active = 0;
+unsigned long bh_mask = 0;
+struct bh_struct bh_base[32];
+
+void do_bottom_half(void)
+{
+	static int running = 0;
+	unsigned long active, mask;
+	struct bh_struct * bh;
+
+	if (running)
+		return;
+	running = 1;
+	sti();
+	while ((active = bh_active & bh_mask) != 0) {
+		cli();
+		bh_active &= ~active;
+		sti();
+		for (bh = bh_base, mask = 1 ; active ; bh++, mask <<= 1)
+			if (active & mask) {
+				active &= ~mask;
+				bh->routine(bh->data);
+			}
+	}
+	running = 0;
+}
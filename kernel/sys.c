@@ -12,6 +12,7 @@
 #include <asm/segment.h>
 #include <sys/times.h>
 #include <sys/utsname.h>
+#include <unistd.h>
 
 int sys_ftime()
 {
@@ -43,11 +44,6 @@ int sys_rename()
 	return -ENOSYS;
 }
 
-int sys_prof()
-{
-	return -ENOSYS;
-}
-
 int sys_setregid(int rgid, int egid)
 {
 	if (rgid>0) {
@@ -180,22 +176,20 @@ int sys_brk(unsigned long end_data_seg)
  */
 int sys_setpgid(int pid, int pgid)
 {
-	int i;
+	struct task_struct * p;
 
 	if (!pid)
 		pid = current->pid;
 	if (!pgid)
 		pgid = current->pid;
-	for (i=0 ; i<NR_TASKS ; i++)
-		if (task[i] && task[i]->pid==pid) {
-			if (task[i]->leader)
-				return -EPERM;
-			if (task[i]->session != current->session)
-				return -EPERM;
-			task[i]->pgrp = pgid;
-			return 0;
-		}
-	return -ESRCH;
+	if (!(p = find_task_by_pid(pid)))
+		return -ESRCH;
+	if (p->leader)
+		return -EPERM;
+	if (p->session != current->session)
+		return -EPERM;
+	p->pgrp = pgid;
+	return 0;
 }
 
 int sys_getpgrp(void)
@@ -234,3 +228,45 @@ int sys_umask(int mask)
 	current->umask = mask & 0777;
 	return (old);
 }
+
+/*
+ * sys_multicall() does a whole array of system calls in one go, to save
+ * the trip through system_call for each of them. The calls are made
+ * exactly as system_call would make them (fs is still the user segment),
+ * and each result goes back into mc_result. We stop early if a signal
+ * comes in, or on the first error if MC_STOP_ON_ERROR is set. Returns
+ * the number of records done, the last one possibly with an error.
+ * No more than MC_MAX_CALLS records at a time: nr*sizeof mustn't wrap
+ * around before verify_area() sees it.
+ */
+int sys_multicall(struct multicall * calls, int nr, int flags)
+{
+	struct multicall * mc;
+	long args[6];
+	long call, res;
+	int i, done;
+
+	if (nr <= 0 || nr > MC_MAX_CALLS || (flags & ~MC_STOP_ON_ERROR))
+		return -EINVAL;
+	verify_area(calls,nr*sizeof(struct multicall));
+	for (done = 0, mc = calls ; done < nr ; done++, mc++) {
+		if (done && (current->signal & ~current->blocked))
+			break;
+		if (!current->counter)
+			schedule();
+		call = get_fs_long((unsigned long *) &mc->mc_nr);
+		if (call < 0 || call >= nr_syscalls ||
+		    (sys_call_flags[call] & SC_NOBATCH))
+			res = -ENOSYS;
+		else {
+			for (i = 0 ; i < 6 ; i++)
+				args[i] = get_fs_long((unsigned long *) &mc->mc_args[i]);
+			res = sys_call_table[call](args[0],args[1],args[2],
+				args[3],args[4],args[5]);
+		}
+		put_fs_long(res,(unsigned long *) &mc->mc_result);
+		if (res < 0 && (flags & MC_STOP_ON_ERROR))
+			return done+1;
+	}
+	return done;
+}
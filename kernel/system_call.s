@@ -58,7 +58,11 @@ sa_mask = 4
 sa_flags = 8
 sa_restorer = 12
 
-nr_system_calls = 72
+nr_system_calls = 81
+
+# flags in _sys_call_flags, see include/linux/sched.h
+SC_FAST = 1
+SC_6ARGS = 2
 
 /*
  * Ok, I get parallel printer interrupts while using the floppy for some
@@ -76,10 +80,31 @@ bad_sys_call:
 reschedule:
 	pushl $ret_from_sys_call
 	jmp _schedule
+/*
+ * Calls that can't sleep or send signals (getpid etc) take a short
+ * cut: only ds is loaded, and they return directly. Note that the flags
+ * are read through %cs, as %ds still is the user's.
+ */
+.align 2
+fast_sys_call:
+	push %ds
+	pushl %edx
+	pushl %ecx
+	pushl %ebx
+	movl $0x10,%edx
+	mov %dx,%ds
+	call _sys_call_table(,%eax,4)
+	popl %ebx
+	popl %ecx
+	popl %edx
+	pop %ds
+	iret
 .align 2
 _system_call:
 	cmpl $nr_system_calls-1,%eax
 	ja bad_sys_call
+	testb $SC_FAST,%cs:_sys_call_flags(%eax)
+	jne fast_sys_call
 	push %ds
 	push %es
 	push %fs
@@ -91,19 +116,40 @@ _system_call:
 	mov %dx,%es
 	movl $0x17,%edx		# fs points to local data space
 	mov %dx,%fs
+	testb $SC_6ARGS,_sys_call_flags(%eax)
+	jne 1f
 	call _sys_call_table(,%eax,4)
 	pushl %eax
-	movl _current,%eax
+	jmp 2f
+/*
+ * Six arguments: push esi, edi and ebp above fresh copies of the first
+ * three, and drop them again afterwards - the stack frame that
+ * ret_from_sys_call and do_signal() know about stays as it is.
+ */
+1:	pushl %ebp
+	pushl %edi
+	pushl %esi
+	pushl 20(%esp)		# edx
+	pushl 20(%esp)		# ecx
+	pushl 20(%esp)		# ebx
+	call _sys_call_table(,%eax,4)
+	addl $24,%esp
+	pushl %eax
+2:	movl _current,%eax
 	cmpl $0,state(%eax)		# state
 	jne reschedule
 	cmpl $0,counter(%eax)		# counter
 	je reschedule
 ret_from_sys_call:
-	movl _current,%eax		# task[0] cannot have signals
-	cmpl _task,%eax
-	je 3f
 	cmpw $0x0f,CS(%esp)		# was old code segment supervisor ?
 	jne 3f
+	movl _bh_active,%eax		# any bottom halves to run?
+	andl _bh_mask,%eax
+	je 4f
+	call _do_bottom_half
+4:	movl _current,%eax		# task[0] cannot have signals
+	cmpl _task,%eax
+	je 3f
 	cmpw $0x17,OLDSS(%esp)		# was stack segment = 0x17 ?
 	jne 3f
 	movl signal(%eax),%ebx
@@ -191,9 +237,10 @@ _timer_interrupt:
 	outb %al,$0x20
 	movl CS(%esp),%eax
 	andl $3,%eax		# %eax is CPL (0 or 3, 0=supervisor)
+	pushl EIP(%esp)		# for the profiler
 	pushl %eax
-	call _do_timer		# 'do_timer(long CPL)' does everything from
-	addl $4,%esp		# task switching to accounting ...
+	call _do_timer		# 'do_timer(long CPL, long EIP)' does everything
+	addl $8,%esp		# from task switching to accounting ...
 	jmp ret_from_sys_call
 
 .align 2
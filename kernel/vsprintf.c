@@ -9,6 +9,14 @@
  * Wirzenius wrote this portably, Torvalds fucked it up :-)
  */
 
+/*
+ * Everything goes through vsnprintf(), which never writes more than
+ * 'size' characters (including the trailing null) but returns how long
+ * the whole result would have been. Text between conversions is copied
+ * in one go, and number() does base 10 two digits per division, and
+ * bases 8 and 16 with shifts.
+ */
+
 #include <stdarg.h>
 #include <string.h>
 
@@ -37,21 +45,48 @@ int __res; \
 __asm__("divl %4":"=a" (n),"=d" (__res):"0" (n),"1" (0),"r" (base)); \
 __res; })
 
-static char * number(char * str, int num, int base, int size, int precision
-	,int type)
+static const char digit_pairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+#define PUTC(c) (void)({if (str < end) *str = (c); ++str;})
+
+/* copy 'len' chars, as far as they fit: returns where the next goes */
+static inline char * copy(char * str, char * end, const char * s, int len)
+{
+	int n = len;
+
+	if (str < end) {
+		if (n > end - str)
+			n = end - str;
+		memcpy(str,s,n);
+	}
+	return str + len;
+}
+
+static char * number(char * str, char * end, unsigned long num, int base,
+	int size, int precision, int type)
 {
 	char c,sign,tmp[36];
 	const char *digits="0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-	int i;
+	int i,r,shift;
 
 	if (type&SMALL) digits="0123456789abcdefghijklmnopqrstuvwxyz";
 	if (type&LEFT) type &= ~ZEROPAD;
 	if (base<2 || base>36)
-		return 0;
+		return str;
 	c = (type & ZEROPAD) ? '0' : ' ' ;
-	if (type&SIGN && num<0) {
+	if (type&SIGN && (long) num<0) {
 		sign='-';
-		num = -num;
+		num = -(long) num;
 	} else
 		sign=(type&PLUS) ? '+' : ((type&SPACE) ? ' ' : 0);
 	if (sign) size--;
@@ -61,40 +96,57 @@ static char * number(char * str, int num, int base, int size, int precision
 	i=0;
 	if (num==0)
 		tmp[i++]='0';
-	else while (num!=0)
+	else if (base==10) {
+		while (num >= 100) {
+			r = do_div(num,100);
+			tmp[i++] = digit_pairs[2*r+1];
+			tmp[i++] = digit_pairs[2*r];
+		}
+		if (num >= 10) {
+			tmp[i++] = digit_pairs[2*num+1];
+			tmp[i++] = digit_pairs[2*num];
+		} else
+			tmp[i++] = '0' + num;
+	} else if (!(base & (base-1))) {
+		for (shift = 1 ; (1 << shift) < base ; shift++)
+			/* nothing */ ;
+		while (num!=0) {
+			tmp[i++] = digits[num & (base-1)];
+			num >>= shift;
+		}
+	} else while (num!=0)
 		tmp[i++]=digits[do_div(num,base)];
 	if (i>precision) precision=i;
 	size -= precision;
 	if (!(type&(ZEROPAD+LEFT)))
 		while(size-->0)
-			*str++ = ' ';
+			PUTC(' ');
 	if (sign)
-		*str++ = sign;
+		PUTC(sign);
 	if (type&SPECIAL)
 		if (base==8)
-			*str++ = '0';
+			PUTC('0');
 		else if (base==16) {
-			*str++ = '0';
-			*str++ = digits[33];
+			PUTC('0');
+			PUTC(digits[33]);
 		}
 	if (!(type&LEFT))
 		while(size-->0)
-			*str++ = c;
+			PUTC(c);
 	while(i<precision--)
-		*str++ = '0';
+		PUTC('0');
 	while(i-->0)
-		*str++ = tmp[i];
+		PUTC(tmp[i]);
 	while(size-->0)
-		*str++ = ' ';
+		PUTC(' ');
 	return str;
 }
 
-int vsprintf(char *buf, const char *fmt, va_list args)
+int vsnprintf(char *buf, int size, const char *fmt, va_list args)
 {
 	int len;
-	int i;
-	char * str;
-	char *s;
+	char * str, * end;
+	const char *s;
 	int *ip;
 
 	int flags;		/* flags to number() */
@@ -104,9 +156,17 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 				   number of chars for from string */
 	int qualifier;		/* 'h', 'l', or 'L' for integer fields */
 
+	if (size < 0)
+		size = 0;
+	end = buf + size;
+	if (end < buf)
+		end = (char *) -1;
 	for (str=buf ; *fmt ; ++fmt) {
 		if (*fmt != '%') {
-			*str++ = *fmt;
+			s = fmt;
+			while (fmt[1] && fmt[1] != '%')
+				fmt++;
+			str = copy(str,end,s,fmt-s+1);
 			continue;
 		}
 			
@@ -160,31 +220,29 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 		case 'c':
 			if (!(flags & LEFT))
 				while (--field_width > 0)
-					*str++ = ' ';
-			*str++ = (unsigned char) va_arg(args, int);
+					PUTC(' ');
+			PUTC((unsigned char) va_arg(args, int));
 			while (--field_width > 0)
-				*str++ = ' ';
+				PUTC(' ');
 			break;
 
 		case 's':
 			s = va_arg(args, char *);
-			len = strlen(s);
-			if (precision < 0)
-				precision = len;
-			else if (len > precision)
-				len = precision;
+			if (!s)
+				s = "<NULL>";
+			for (len = 0 ; len != precision && s[len] ; len++)
+				/* nothing */ ;
 
 			if (!(flags & LEFT))
 				while (len < field_width--)
-					*str++ = ' ';
-			for (i = 0; i < len; ++i)
-				*str++ = *s++;
+					PUTC(' ');
+			str = copy(str,end,s,len);
 			while (len < field_width--)
-				*str++ = ' ';
+				PUTC(' ');
 			break;
 
 		case 'o':
-			str = number(str, va_arg(args, unsigned long), 8,
+			str = number(str, end, va_arg(args, unsigned long), 8,
 				field_width, precision, flags);
 			break;
 
@@ -193,7 +251,7 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 				field_width = 8;
 				flags |= ZEROPAD;
 			}
-			str = number(str,
+			str = number(str, end,
 				(unsigned long) va_arg(args, void *), 16,
 				field_width, precision, flags);
 			break;
@@ -201,7 +259,7 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 		case 'x':
 			flags |= SMALL;
 		case 'X':
-			str = number(str, va_arg(args, unsigned long), 16,
+			str = number(str, end, va_arg(args, unsigned long), 16,
 				field_width, precision, flags);
 			break;
 
@@ -209,7 +267,7 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 		case 'i':
 			flags |= SIGN;
 		case 'u':
-			str = number(str, va_arg(args, unsigned long), 10,
+			str = number(str, end, va_arg(args, unsigned long), 10,
 				field_width, precision, flags);
 			break;
 
@@ -220,14 +278,22 @@ int vsprintf(char *buf, const char *fmt, va_list args)
 
 		default:
 			if (*fmt != '%')
-				*str++ = '%';
+				PUTC('%');
 			if (*fmt)
-				*str++ = *fmt;
+				PUTC(*fmt);
 			else
 				--fmt;
 			break;
 		}
 	}
-	*str = '\0';
+	if (str < end)
+		*str = '\0';
+	else if (size > 0)
+		end[-1] = '\0';
 	return str-buf;
 }
+
+int vsprintf(char *buf, const char *fmt, va_list args)
+{
+	return vsnprintf(buf, 0x7fffffff, fmt, args);
+}
@@ -0,0 +1,246 @@
+/*
+ *  linux/lib/slab.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * slab.c is a cache of fixed-size kernel objects, for things that are
+ * allocated and freed often enough that malloc() isn't good enough:
+ * malloc() rounds everything up to a power of two, and free_s() has to
+ * search all the bucket chains for the page of the object.
+ *
+ * Every cache gets whole pages (slabs) from get_free_page(). A slab
+ * starts with a small header, and the rest is cut up into objects.
+ * Since the header is at the start of the page, kmem_cache_free() finds
+ * the slab of an object simply by masking off the low bits of its
+ * address. Each object has a word after it that is used to chain it
+ * into the free list of its slab: this way a free object keeps whatever
+ * the constructor put into it, and a cache with a constructor hands
+ * out objects that are already initialized.
+ *
+ * The slabs of a cache are kept on three lists: full, partial and
+ * free. Allocation comes from a partial slab if there is one, so that
+ * empty slabs can be given back. At most one empty slab is kept around
+ * per cache, to avoid going back and forth to get_free_page().
+ *
+ * Only file structures come from here so far (fs/file_table.c). The
+ * other fixed tables stay as they are for now: request[] is what
+ * swap_out() writes pages out with when memory is short, so it mustn't
+ * need a page itself; inode_table[] is the in-core inode cache that
+ * iget() searches, not just storage; a task_struct shares its page
+ * with the kernel stack; and timers are part of the structures that
+ * use them, so there's nothing to allocate.
+ *
+ * As with malloc(), the lists are only touched with interrupts off.
+ * The flags are saved and restored around that, not just turned back
+ * on, as some callers (get_free_page() through kmem_cache_shrink())
+ * already run with interrupts off.
+ */
+
+#include <stddef.h>
+
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <asm/system.h>
+
+struct slab {
+	struct kmem_cache * s_cache;
+	struct slab * s_next;
+	struct slab * s_prev;
+	void * s_freeptr;
+	unsigned short s_inuse;
+	unsigned short s_magic;
+};
+
+#define SLAB_MAGIC 0x5ab1
+
+struct kmem_cache {
+	const char * c_name;
+	unsigned short c_size;		/* object size, as asked for */
+	unsigned short c_slot;		/* object + free-list link, aligned */
+	unsigned short c_num;		/* objects per slab */
+	unsigned short c_nr_free_slabs;
+	void (*c_ctor)(void *);
+	struct slab * c_full;
+	struct slab * c_partial;
+	struct slab * c_free;
+	struct kmem_cache * c_next;
+};
+
+static struct kmem_cache * cache_chain = NULL;
+
+#define slab_of(obj) ((struct slab *) ((unsigned long) (obj) & 0xfffff000))
+#define link_of(cachep,obj) (*(void **) ((char *) (obj) + (cachep)->c_size))
+#define first_obj(slabp) ((char *) ((slabp)+1))
+
+static inline void slab_unlink(struct slab ** list, struct slab * slabp)
+{
+	if (slabp->s_next)
+		slabp->s_next->s_prev = slabp->s_prev;
+	if (slabp->s_prev)
+		slabp->s_prev->s_next = slabp->s_next;
+	else
+		*list = slabp->s_next;
+}
+
+static inline void slab_link(struct slab ** list, struct slab * slabp)
+{
+	slabp->s_prev = NULL;
+	slabp->s_next = *list;
+	if (*list)
+		(*list)->s_prev = slabp;
+	*list = slabp;
+}
+
+/*
+ * kmem_cache_create() sets up a new cache of objects of 'size' bytes.
+ * 'ctor', if not NULL, is called once for every object when its slab is
+ * set up - the objects have to be given back in the same state.
+ * Returns NULL if the objects are too big to fit a page.
+ */
+struct kmem_cache * kmem_cache_create(const char * name, int size,
+	void (*ctor)(void *))
+{
+	struct kmem_cache * cachep;
+	unsigned long flags;
+	int slot;
+
+	size = (size + 3) & ~3;
+	slot = size + sizeof(void *);
+	if (size <= 0 || slot > PAGE_SIZE - sizeof(struct slab))
+		return NULL;
+	if (!(cachep = (struct kmem_cache *) malloc(sizeof(struct kmem_cache))))
+		return NULL;
+	cachep->c_name = name;
+	cachep->c_size = size;
+	cachep->c_slot = slot;
+	cachep->c_num = (PAGE_SIZE - sizeof(struct slab)) / slot;
+	cachep->c_nr_free_slabs = 0;
+	cachep->c_ctor = ctor;
+	cachep->c_full = cachep->c_partial = cachep->c_free = NULL;
+	save_flags(flags);
+	cli();
+	cachep->c_next = cache_chain;
+	cache_chain = cachep;
+	restore_flags(flags);
+	return cachep;
+}
+
+/*
+ * Get a new page for the cache, and run the constructor over it. Note
+ * that get_free_page() may sleep: the slab is only linked in when it's
+ * completely set up.
+ */
+static int kmem_cache_grow(struct kmem_cache * cachep)
+{
+	struct slab * slabp;
+	unsigned long flags;
+	char * obj;
+	int i;
+
+	if (!(slabp = (struct slab *) get_free_page()))
+		return 0;
+	slabp->s_cache = cachep;
+	slabp->s_inuse = 0;
+	slabp->s_magic = SLAB_MAGIC;
+	slabp->s_freeptr = obj = first_obj(slabp);
+	for (i = cachep->c_num ; i > 0 ; i--, obj += cachep->c_slot) {
+		if (cachep->c_ctor)
+			cachep->c_ctor(obj);
+		link_of(cachep,obj) = (i > 1) ? obj + cachep->c_slot : NULL;
+	}
+	save_flags(flags);
+	cli();
+	slab_link(&cachep->c_free,slabp);
+	cachep->c_nr_free_slabs++;
+	restore_flags(flags);
+	return 1;
+}
+
+void * kmem_cache_alloc(struct kmem_cache * cachep)
+{
+	struct slab * slabp;
+	unsigned long flags;
+	void * obj;
+
+	save_flags(flags);
+	cli();
+	while (!(slabp = cachep->c_partial)) {
+		if ((slabp = cachep->c_free) != NULL) {
+			slab_unlink(&cachep->c_free,slabp);
+			cachep->c_nr_free_slabs--;
+			slab_link(&cachep->c_partial,slabp);
+			break;
+		}
+		restore_flags(flags);
+		if (!kmem_cache_grow(cachep))
+			return NULL;
+		cli();
+	}
+	obj = slabp->s_freeptr;
+	slabp->s_freeptr = link_of(cachep,obj);
+	if (++slabp->s_inuse == cachep->c_num) {
+		slab_unlink(&cachep->c_partial,slabp);
+		slab_link(&cachep->c_full,slabp);
+	}
+	restore_flags(flags);
+	return obj;
+}
+
+void kmem_cache_free(struct kmem_cache * cachep, void * obj)
+{
+	struct slab * slabp = slab_of(obj);
+	unsigned long page = 0, flags;
+
+	if (slabp->s_magic != SLAB_MAGIC || slabp->s_cache != cachep)
+		panic("kmem_cache_free: bad object");
+	save_flags(flags);
+	cli();
+	link_of(cachep,obj) = slabp->s_freeptr;
+	slabp->s_freeptr = obj;
+	if (slabp->s_inuse-- == cachep->c_num) {
+		slab_unlink(&cachep->c_full,slabp);
+		slab_link(&cachep->c_partial,slabp);
+	}
+	if (!slabp->s_inuse) {
+		slab_unlink(&cachep->c_partial,slabp);
+		if (cachep->c_nr_free_slabs) {
+			slabp->s_magic = 0;
+			page = (unsigned long) slabp;
+		} else {
+			slab_link(&cachep->c_free,slabp);
+			cachep->c_nr_free_slabs++;
+		}
+	}
+	restore_flags(flags);
+	if (page)
+		free_page(page);
+}
+
+/*
+ * kmem_cache_shrink() gives back the empty slabs that are kept around
+ * in every cache. It returns the number of pages freed, and doesn't
+ * sleep, so get_free_page() can use it when memory runs out.
+ */
+int kmem_cache_shrink(void)
+{
+	struct kmem_cache * cachep;
+	struct slab * slabp;
+	unsigned long flags;
+	int freed = 0;
+
+	save_flags(flags);
+	for (cachep = cache_chain ; cachep ; cachep = cachep->c_next) {
+		cli();
+		while ((slabp = cachep->c_free) != NULL) {
+			slab_unlink(&cachep->c_free,slabp);
+			cachep->c_nr_free_slabs--;
+			slabp->s_magic = 0;
+			free_page((unsigned long) slabp);
+			freed++;
+		}
+		restore_flags(flags);
+	}
+	return freed;
+}
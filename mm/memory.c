@@ -36,31 +36,22 @@ static inline volatile void oom(void)
 	do_exit(SIGSEGV);
 }
 
-#define invalidate() \
-__asm__("movl %%eax,%%cr3"::"a" (0))
-
-/* these are not to be changed without changing head.s etc */
-#define LOW_MEM 0x100000
-#define PAGING_MEMORY (15*1024*1024)
-#define PAGING_PAGES (PAGING_MEMORY>>12)
-#define MAP_NR(addr) (((addr)-LOW_MEM)>>12)
-#define USED 100
-
 #define CODE_SPACE(addr) ((((addr)+4095)&~4095) < \
 current->start_code + current->end_code)
 
-static long HIGH_MEMORY = 0;
+long HIGH_MEMORY = 0;
 
 #define copy_page(from,to) \
 __asm__("cld ; rep ; movsl"::"S" (from),"D" (to),"c" (1024):"cx","di","si")
 
-static unsigned char mem_map [ PAGING_PAGES ] = {0,};
+unsigned char mem_map [ PAGING_PAGES ] = {0,};
+int nr_free_pages = 0;
 
 /*
  * Get physical address of first (actually last :-) free page, and mark it
  * used. If no free pages left, return 0.
  */
-unsigned long get_free_page(void)
+static unsigned long find_free_page(void)
 {
 register unsigned long __res asm("ax");
 
@@ -82,6 +73,24 @@ __asm__("std ; repne ; scasb\n\t"
 return __res;
 }
 
+/*
+ * If we're out of pages, try to get some back from the page cache, the
+ * empty slabs and the buffer cache before giving up - those are only kept around for
+ * speed - and then page something out. Note that the latter two mean
+ * get_free_page() can sleep.
+ */
+unsigned long get_free_page(void)
+{
+	unsigned long page;
+
+	while (!(page = find_free_page()))
+		if (!shrink_page_cache() && !kmem_cache_shrink() &&
+		    !shrink_buffers() && !swap_out())
+			return 0;
+	nr_free_pages--;
+	return page;
+}
+
 /*
  * Free a page of memory at physical address 'addr'. Used by
  * 'free_page_tables()'
@@ -93,7 +102,11 @@ void free_page(unsigned long addr)
 		panic("trying to free nonexistent page");
 	addr -= LOW_MEM;
 	addr >>= 12;
-	if (mem_map[addr]--) return;
+	if (mem_map[addr]--) {
+		if (!mem_map[addr])
+			nr_free_pages++;
+		return;
+	}
 	mem_map[addr]=0;
 	panic("trying to free free page");
 }
@@ -120,6 +133,8 @@ int free_page_tables(unsigned long from,unsigned long size)
 		for (nr=0 ; nr<1024 ; nr++) {
 			if (1 & *pg_table)
 				free_page(0xfffff000 & *pg_table);
+			else if (*pg_table)
+				swap_free(*pg_table >> 1);
 			*pg_table = 0;
 			pg_table++;
 		}
@@ -172,8 +187,13 @@ int copy_page_tables(unsigned long from,unsigned long to,long size)
 		nr = (from==0)?0xA0:1024;
 		for ( ; nr-- > 0 ; from_page_table++,to_page_table++) {
 			this_page = *from_page_table;
-			if (!(1 & this_page))
+			if (!this_page)
 				continue;
+			if (!(1 & this_page)) {
+				if (!swap_in(from_page_table))
+					return -1;
+				this_page = *from_page_table;
+			}
 			this_page &= ~2;
 			*to_page_table = this_page;
 			if (this_page > LOW_MEM) {
@@ -218,11 +238,70 @@ unsigned long put_page(unsigned long page,unsigned long address)
 	return page;
 }
 
+/*
+ * put_dirty_page() is used by exec for the argument pages: the kernel
+ * has filled them in through the physical address, so the dirty bit
+ * must be set by hand, or the swapper would think it can just drop
+ * them.
+ */
+unsigned long put_dirty_page(unsigned long page,unsigned long address)
+{
+	unsigned long tmp, *page_table;
+
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
+		printk("Trying to put page %p at %p\n",page,address);
+	if (mem_map[(page-LOW_MEM)>>12] != 1)
+		printk("mem_map disagrees with %p at %p\n",page,address);
+	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	if ((*page_table)&1)
+		page_table = (unsigned long *) (0xfffff000 & *page_table);
+	else {
+		if (!(tmp=get_free_page()))
+			return 0;
+		*page_table = tmp|7;
+		page_table = (unsigned long *) tmp;
+	}
+	page_table[(address>>12) & 0x3ff] = page | (PAGE_DIRTY | 7);
+/* no need for invalidate */
+	return page;
+}
+
+/*
+ * put_shared_page() is put_page() for pages that somebody else (the
+ * page cache) holds on to as well: the page is mapped write-protected,
+ * so that a write to it gets a private copy through do_wp_page().
+ */
+static unsigned long put_shared_page(unsigned long page,unsigned long address)
+{
+	unsigned long tmp, *page_table;
+
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
+		printk("Trying to put page %p at %p\n",page,address);
+	page_table = (unsigned long *) ((address>>20) & 0xffc);
+	if ((*page_table)&1)
+		page_table = (unsigned long *) (0xfffff000 & *page_table);
+	else {
+		if (!(tmp=get_free_page()))
+			return 0;
+		*page_table = tmp|7;
+		page_table = (unsigned long *) tmp;
+	}
+	page_table[(address>>12) & 0x3ff] = page | 5;
+/* no need for invalidate */
+	return page;
+}
+
+/*
+ * The copy is marked dirty right away: it may differ from what's in
+ * the executable, and we might get here from write_verify() rather
+ * than from a real write.
+ */
 void un_wp_page(unsigned long * table_entry)
 {
-	unsigned long old_page,new_page;
+	unsigned long old_entry,old_page,new_page;
 
-	old_page = 0xfffff000 & *table_entry;
+	old_entry = *table_entry;
+	old_page = 0xfffff000 & old_entry;
 	if (old_page >= LOW_MEM && mem_map[MAP_NR(old_page)]==1) {
 		*table_entry |= 2;
 		invalidate();
@@ -230,9 +309,14 @@ void un_wp_page(unsigned long * table_entry)
 	}
 	if (!(new_page=get_free_page()))
 		oom();
+/* get_free_page() may have slept, and the swapper changed things */
+	if (*table_entry != old_entry) {
+		free_page(new_page);
+		return;
+	}
 	if (old_page >= LOW_MEM)
 		mem_map[MAP_NR(old_page)]--;
-	*table_entry = new_page | 7;
+	*table_entry = new_page | (PAGE_DIRTY | 7);
 	invalidate();
 	copy_page(old_page,new_page);
 }	
@@ -252,6 +336,7 @@ void do_wp_page(unsigned long error_code,unsigned long address)
 	if (CODE_SPACE(address))
 		do_exit(SIGSEGV);
 #endif
+	current->min_flt++;
 	un_wp_page((unsigned long *)
 		(((address>>10) & 0xffc) + (0xfffff000 &
 		*((unsigned long *) ((address>>20) &0xffc)))));
@@ -343,20 +428,18 @@ static int try_to_share(unsigned long address, struct task_struct * p)
  */
 static int share_page(unsigned long address)
 {
-	struct task_struct ** p;
+	struct task_struct * p;
 
 	if (!current->executable)
 		return 0;
 	if (current->executable->i_count < 2)
 		return 0;
-	for (p = &LAST_TASK ; p > &FIRST_TASK ; --p) {
-		if (!*p)
+	for_each_task(p) {
+		if (current == p)
 			continue;
-		if (current == *p)
+		if (p->executable != current->executable)
 			continue;
-		if ((*p)->executable != current->executable)
-			continue;
-		if (try_to_share(address,*p))
+		if (try_to_share(address,p))
 			return 1;
 	}
 	return 0;
@@ -367,30 +450,59 @@ void do_no_page(unsigned long error_code,unsigned long address)
 	int nr[4];
 	unsigned long tmp;
 	unsigned long page;
+	unsigned long offset;
+	struct m_inode * inode;
 	int block,i;
 
 	address &= 0xfffff000;
+	page = *(unsigned long *) ((address >> 20) & 0xffc);
+	if (page & 1) {
+		page &= 0xfffff000;
+		page += (address >> 10) & 0xffc;
+		if (*(unsigned long *) page) {
+			current->maj_flt++;
+			if (!swap_in((unsigned long *) page))
+				oom();
+			return;
+		}
+	}
 	tmp = address - current->start_code;
 	if (!current->executable || tmp >= current->end_data) {
+		current->min_flt++;
 		get_empty_page(address);
 		return;
 	}
-	if (share_page(tmp))
+	inode = current->executable;
+	if (page = find_cached_page(inode->i_dev,inode->i_num,tmp>>12)) {
+		current->min_flt++;
+		if (put_shared_page(page,address))
+			return;
+		free_page(page);
+		oom();
+	}
+	if (share_page(tmp)) {
+		current->min_flt++;
 		return;
+	}
+	current->maj_flt++;
 	if (!(page = get_free_page()))
 		oom();
 /* remember that 1 block is used for header */
 	block = 1 + tmp/BLOCK_SIZE;
 	for (i=0 ; i<4 ; block++,i++)
-		nr[i] = bmap(current->executable,block);
-	bread_page(page,current->executable->i_dev,nr);
+		nr[i] = bmap(inode,block);
+	bread_page(page,inode->i_dev,nr);
 	i = tmp + 4096 - current->end_data;
+	offset = tmp>>12;
 	tmp = page + 4096;
 	while (i-- > 0) {
 		tmp--;
 		*(char *)tmp = 0;
 	}
-	if (put_page(page,address))
+	if (add_to_page_cache(page,inode->i_dev,inode->i_num,offset)) {
+		if (put_shared_page(page,address))
+			return;
+	} else if (put_page(page,address))
 		return;
 	free_page(page);
 	oom();
@@ -406,6 +518,7 @@ void mem_init(long start_mem, long end_mem)
 	i = MAP_NR(start_mem);
 	end_mem -= start_mem;
 	end_mem >>= 12;
+	nr_free_pages = end_mem;
 	while (end_mem-->0)
 		mem_map[i++]=0;
 }
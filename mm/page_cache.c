@@ -0,0 +1,172 @@
+/*
+ *  linux/mm/page_cache.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * page_cache.c keeps the pages of executables around after the last
+ * task using them has exited, so that the next exec of the same binary
+ * can have them mapped directly by do_no_page(), without going through
+ * bread_page() again.
+ *
+ * Pages are indexed by (device, inode number, page offset in the
+ * executable). The cache holds one mem_map reference on every page it
+ * knows about, and all mappings of a cached page are write-protected:
+ * a write to one simply takes the normal copy-on-write path through
+ * un_wp_page(). A page whose only user is the cache can be thrown out
+ * at any time - shrink_page_cache() does that when get_free_page()
+ * runs out of pages.
+ */
+#include <linux/sched.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+
+#define NR_CACHE_PAGES 256
+#define NR_CACHE_HASH 61
+
+struct cache_page {
+	unsigned long c_page;		/* physical address, 0 = free slot */
+	unsigned long c_offset;		/* page number within the file */
+	unsigned short c_dev;
+	unsigned short c_ino;
+	struct cache_page * c_next;	/* hash chain */
+};
+
+static struct cache_page cache_table[NR_CACHE_PAGES];
+static struct cache_page * cache_hash[NR_CACHE_HASH];
+static struct cache_page * cache_hand = cache_table;
+static int nr_cached_pages = 0;
+
+#define _hashfn(dev,ino,offset) \
+	(((unsigned)((dev)^(ino)^(offset)))%NR_CACHE_HASH)
+#define hash(dev,ino,offset) cache_hash[_hashfn(dev,ino,offset)]
+
+static struct cache_page * find_entry(int dev, int ino, unsigned long offset)
+{
+	struct cache_page * p;
+
+	for (p = hash(dev,ino,offset) ; p ; p = p->c_next)
+		if (p->c_dev == dev && p->c_ino == ino && p->c_offset == offset)
+			return p;
+	return NULL;
+}
+
+static void remove_entry(struct cache_page * p)
+{
+	struct cache_page ** q;
+
+	q = &hash(p->c_dev,p->c_ino,p->c_offset);
+	while (*q != p) {
+		if (!*q)
+			panic("page cache hash chain corrupted");
+		q = &(*q)->c_next;
+	}
+	*q = p->c_next;
+	free_page(p->c_page);
+	p->c_page = 0;
+	p->c_dev = p->c_ino = 0;
+	p->c_next = NULL;
+	nr_cached_pages--;
+}
+
+/*
+ * find_cached_page() returns the physical address of the wanted page
+ * with an extra reference taken for the caller, or 0 if it isn't in
+ * the cache.
+ */
+unsigned long find_cached_page(int dev, int ino, unsigned long offset)
+{
+	struct cache_page * p;
+
+	if (!(p = find_entry(dev,ino,offset)))
+		return 0;
+	mem_map[MAP_NR(p->c_page)]++;
+	return p->c_page;
+}
+
+/*
+ * add_to_page_cache() enters a freshly read, clean page. It returns 1
+ * if the cache took a reference to the page (and the caller must then
+ * map it read-only), 0 if there was no room or somebody beat us to it
+ * while we slept in bread_page().
+ */
+int add_to_page_cache(unsigned long page, int dev, int ino,
+	unsigned long offset)
+{
+	struct cache_page * p;
+	int i;
+
+	if (page < LOW_MEM || page >= HIGH_MEMORY)
+		return 0;
+	if (find_entry(dev,ino,offset))
+		return 0;
+	for (i = NR_CACHE_PAGES ; i ; i--) {
+		if (++cache_hand >= cache_table + NR_CACHE_PAGES)
+			cache_hand = cache_table;
+		if (!cache_hand->c_page)
+			break;
+		if (mem_map[MAP_NR(cache_hand->c_page)] == 1) {
+			remove_entry(cache_hand);
+			break;
+		}
+	}
+	if (!i)
+		return 0;
+	p = cache_hand;
+	p->c_page = page;
+	p->c_dev = dev;
+	p->c_ino = ino;
+	p->c_offset = offset;
+	p->c_next = hash(dev,ino,offset);
+	hash(dev,ino,offset) = p;
+	mem_map[MAP_NR(page)]++;
+	nr_cached_pages++;
+	return 1;
+}
+
+/*
+ * Called whenever the contents of a file change under us (write,
+ * truncate), so that the next exec doesn't see stale text.
+ */
+void invalidate_inode_pages(int dev, int ino)
+{
+	struct cache_page * p;
+
+	if (!nr_cached_pages)
+		return;
+	for (p = cache_table ; p < cache_table + NR_CACHE_PAGES ; p++)
+		if (p->c_page && p->c_dev == dev && p->c_ino == ino)
+			remove_entry(p);
+}
+
+void invalidate_dev_pages(int dev)
+{
+	struct cache_page * p;
+
+	if (!nr_cached_pages)
+		return;
+	for (p = cache_table ; p < cache_table + NR_CACHE_PAGES ; p++)
+		if (p->c_page && p->c_dev == dev)
+			remove_entry(p);
+}
+
+/*
+ * shrink_page_cache() drops cached pages that no task has mapped any
+ * more. It returns the number of pages given back to the free pool.
+ * This doesn't sleep, so it's ok to call it from get_free_page().
+ */
+int shrink_page_cache(void)
+{
+	struct cache_page * p;
+	int freed = 0;
+
+	if (!nr_cached_pages)
+		return 0;
+	for (p = cache_table ; p < cache_table + NR_CACHE_PAGES ; p++)
+		if (p->c_page && mem_map[MAP_NR(p->c_page)] == 1) {
+			remove_entry(p);
+			freed++;
+		}
+	return freed;
+}
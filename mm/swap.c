@@ -0,0 +1,306 @@
+/*
+ *  linux/mm/swap.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * This file contains the code for paging anonymous memory out to a
+ * swap area and back in again. The swap area can be a block device or
+ * a regular file: in the latter case the pages go through the buffer
+ * cache (bread_page/bwrite_page), in the former they are read and
+ * written directly with ll_rw_page().
+ *
+ * The first page of the swap area holds the "SWAP-SPACE" signature in
+ * its last 10 bytes, and a bitmap of the usable pages (as written by
+ * mkswap). In memory, a set bit in swap_bitmap means the page is free.
+ *
+ * A swapped-out page-table entry has the present bit clear and holds
+ * the swap page number shifted left one bit.
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/head.h>
+#include <linux/kernel.h>
+#include <asm/system.h>
+
+#define SWAP_BITS (4096<<3)
+
+#define bitop(name,op) \
+static inline int name(char * addr,unsigned int nr) \
+{ \
+int __res; \
+__asm__ __volatile__("bt" op " %1,%2; adcl $0,%0" \
+:"=g" (__res) \
+:"r" (nr),"m" (*(addr)),"0" (0)); \
+return __res; \
+}
+
+bitop(bit,"")
+bitop(setbit,"s")
+bitop(clrbit,"r")
+
+static char * swap_bitmap = NULL;
+static char * swap_lockmap = NULL;
+static int swap_dev = 0;
+static struct m_inode * swap_file = NULL;
+static int swap_pages = 0;
+static int swap_rover = 0;
+static struct wait_queue * swap_wait = NULL;
+
+/*
+ * We don't page out anything in the first 64MB of linear space: that's
+ * task 0, ie the kernel itself.
+ */
+#define FIRST_VM_PAGE (0x4000000>>12)
+#define LAST_VM_PAGE (1024*1024)
+#define VM_PAGES (LAST_VM_PAGE - FIRST_VM_PAGE)
+
+/* returns 0 if a read failed */
+static int rw_swap_page(int rw, int nr, char * buf)
+{
+	int zones[4];
+	int i;
+
+	if (!swap_file)
+		return ll_rw_page(rw,swap_dev,nr,buf);
+	for (i=0 ; i<4 ; i++)
+		zones[i] = bmap(swap_file,(nr<<2)+i);
+	if (rw == READ)
+		return bread_page((unsigned long) buf,swap_dev,zones);
+	bwrite_page((unsigned long) buf,swap_dev,zones);
+	return 1;
+}
+
+static int get_swap_page(void)
+{
+	int i;
+
+	if (!swap_bitmap)
+		return 0;
+	for (i = swap_pages ; i > 0 ; i--) {
+		if (++swap_rover >= swap_pages)
+			swap_rover = 1;
+		if (bit(swap_lockmap,swap_rover))
+			continue;
+		if (clrbit(swap_bitmap,swap_rover))
+			return swap_rover;
+	}
+	return 0;
+}
+
+void swap_free(int nr)
+{
+	if (!swap_bitmap || nr <= 0 || nr >= swap_pages) {
+		printk("Trying to free nonexistent swap-page %d\n\r",nr);
+		return;
+	}
+	if (setbit(swap_bitmap,nr))
+		printk("swap_free: swap-space bitmap bad\n\r");
+}
+
+/*
+ * swap_in() brings a swapped-out page back in, and points the
+ * page-table entry at it. It returns 0 if that couldn't be done: out of
+ * memory, or a read error. The entry is left as it is then, and the
+ * caller kills the task - mapping in a page of zeroes instead would lose
+ * the data without a word.
+ */
+int swap_in(unsigned long * table_ptr)
+{
+	unsigned long entry, page;
+	int nr, ok;
+
+	entry = *table_ptr;
+	if (entry & PAGE_PRESENT)
+		return 1;
+	nr = entry >> 1;
+	if (!swap_bitmap || nr <= 0 || nr >= swap_pages) {
+		printk("swap_in: bad swap entry %08x\n\r",entry);
+		return 0;
+	}
+	while (bit(swap_lockmap,nr))
+		sleep_on(&swap_wait);
+	if (!(page = get_free_page()))
+		return 0;
+	if (*table_ptr != entry) {
+		free_page(page);
+		return 1;
+	}
+	ok = rw_swap_page(READ,nr,(char *) page);
+	if (*table_ptr != entry) {
+		free_page(page);
+		return 1;
+	}
+	if (!ok) {
+		printk("swap_in: error reading swap page %d\n\r",nr);
+		free_page(page);
+		return 0;
+	}
+	swap_free(nr);
+	*table_ptr = page | (PAGE_DIRTY | 7);
+	return 1;
+}
+
+/*
+ * This is the clock hand: a page that has been used since we last
+ * looked at it gets its accessed bit cleared and is left alone. Clean
+ * pages can just be dropped, as they can be read in again from the
+ * executable (or are zero-pages). Dirty pages are written out, unless
+ * they are shared. If the write fails, the page stays where it was.
+ */
+static int try_to_swap_out(unsigned long * table_ptr)
+{
+	unsigned long page, old;
+	int nr;
+
+	page = *table_ptr;
+	if (!(PAGE_PRESENT & page))
+		return 0;
+	if ((page & 0xfffff000) < LOW_MEM || (page & 0xfffff000) >= HIGH_MEMORY)
+		return 0;
+	if (PAGE_ACCESSED & page) {
+		*table_ptr = page & ~PAGE_ACCESSED;
+		return 0;
+	}
+	if (!(PAGE_DIRTY & page)) {
+		*table_ptr = 0;
+		invalidate();
+		free_page(page & 0xfffff000);
+		return 1;
+	}
+	page &= 0xfffff000;
+	if (mem_map[MAP_NR(page)] != 1)
+		return 0;
+	if (!(nr = get_swap_page()))
+		return 0;
+	old = *table_ptr;
+	setbit(swap_lockmap,nr);
+	*table_ptr = nr<<1;
+	invalidate();
+	if (!rw_swap_page(WRITE,nr,(char *) page)) {
+		printk("try_to_swap_out: error writing swap page %d\n\r",nr);
+		*table_ptr = old;
+		invalidate();
+		swap_free(nr);
+		clrbit(swap_lockmap,nr);
+		wake_up(&swap_wait);
+		return 0;
+	}
+	clrbit(swap_lockmap,nr);
+	wake_up(&swap_wait);
+	free_page(page);
+	return 1;
+}
+
+/*
+ * swap_out() is called by get_free_page() when there are no free pages
+ * left. It goes round the user part of the page tables at most twice
+ * (the first time round may only clear accessed bits), and returns 1
+ * as soon as it has freed a page.
+ */
+int swap_out(void)
+{
+	static unsigned long vm_page = FIRST_VM_PAGE;
+	unsigned long pg_table;
+	int counter = 2*VM_PAGES;
+
+	while (counter > 0) {
+		if (vm_page >= LAST_VM_PAGE) {
+			vm_page = FIRST_VM_PAGE;
+			invalidate();
+		}
+		pg_table = pg_dir[vm_page>>10];
+		if (!(pg_table & 1)) {
+			counter -= 1024 - (vm_page & 1023);
+			vm_page = (vm_page | 1023) + 1;
+			continue;
+		}
+		pg_table &= 0xfffff000;
+		counter--;
+		if (try_to_swap_out((vm_page++ & 1023) + (unsigned long *) pg_table))
+			return 1;
+	}
+	invalidate();
+	if (swap_bitmap)
+		printk("Out of swap-memory\n\r");
+	return 0;
+}
+
+int sys_swapon(const char * specialfile)
+{
+	struct m_inode * inode;
+	char * bitmap, * lockmap;
+	int i,j,pages;
+
+	if (!suser())
+		return -EPERM;
+	if (!(inode=namei(specialfile)))
+		return -ENOENT;
+	if (swap_bitmap || swap_dev) {
+		iput(inode);
+		return -EBUSY;
+	}
+	if (S_ISBLK(inode->i_mode) && MAJOR(inode->i_zone[0]) != 2) {
+		swap_dev = inode->i_zone[0];
+		swap_file = NULL;
+		pages = SWAP_BITS;
+		iput(inode);
+	} else if (S_ISREG(inode->i_mode)) {
+		swap_dev = inode->i_dev;
+		swap_file = inode;
+		pages = inode->i_size >> 12;
+	} else {
+		iput(inode);
+		return -EINVAL;
+	}
+	if (pages > SWAP_BITS)
+		pages = SWAP_BITS;
+	bitmap = lockmap = NULL;
+	if (pages < 2)
+		goto bad;
+	if (!(bitmap = (char *) get_free_page()) ||
+	    !(lockmap = (char *) get_free_page()))
+		goto bad;
+	if (!rw_swap_page(READ,0,bitmap) ||
+	    strncmp("SWAP-SPACE",bitmap+4086,10)) {
+		printk("Unable to find swap-space signature\n\r");
+		goto bad;
+	}
+	memset(bitmap+4086,0,10);
+	clrbit(bitmap,0);
+	for (i = pages ; i < SWAP_BITS ; i++)
+		clrbit(bitmap,i);
+	j = 0;
+	for (i = 1 ; i < pages ; i++) {
+		if (!bit(bitmap,i))
+			continue;
+/* a swap file mustn't have holes: we never allocate blocks for it */
+		if (swap_file && !(bmap(swap_file,i<<2) &&
+		    bmap(swap_file,(i<<2)+1) && bmap(swap_file,(i<<2)+2) &&
+		    bmap(swap_file,(i<<2)+3))) {
+			clrbit(bitmap,i);
+			continue;
+		}
+		j++;
+	}
+	if (!j)
+		goto bad;
+	swap_pages = pages;
+	swap_lockmap = lockmap;
+	swap_bitmap = bitmap;
+	printk("Adding swap: %d pages (%d bytes) swap-space\n\r",j,j*4096);
+	return 0;
+bad:
+	free_page((unsigned long) bitmap);
+	free_page((unsigned long) lockmap);
+	iput(swap_file);
+	swap_file = NULL;
+	swap_dev = 0;
+	return -EINVAL;
+}
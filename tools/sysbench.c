@@ -0,0 +1,74 @@
+/*
+ *  linux/tools/sysbench.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * sysbench is a small user program that times system call round trips:
+ * getpid() (which takes the short path in system_call.s), a zero-length
+ * read() (the full path, but no work), and a one-byte write+read through
+ * a pipe. It is meant to be run on the new kernel, not on the host:
+ *
+ *	sysbench [loops]
+ *
+ * Timing is done with times(), so the loop count has to be big enough
+ * for the result to be more than a few ticks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/times.h>
+
+#define HZ 100
+#define DEFAULT_LOOPS 100000
+
+static long loops = DEFAULT_LOOPS;
+
+static long ticks(void)
+{
+	struct tms t;
+
+	times(&t);
+	return t.tms_utime + t.tms_stime;
+}
+
+static void report(const char * name, long start)
+{
+	long t = ticks() - start;
+
+	if (t <= 0)
+		t = 1;
+	printf("%-12s %8ld calls in %5ld ticks: %6ld ns/call\n",
+		name, loops, t, (t * (1000000000/HZ)) / loops);
+}
+
+int main(int argc, char ** argv)
+{
+	char buf[1];
+	int fd[2];
+	long i, start;
+
+	if (argc > 1 && (loops = atol(argv[1])) <= 0)
+		loops = DEFAULT_LOOPS;
+	start = ticks();
+	for (i = 0 ; i < loops ; i++)
+		getpid();
+	report("getpid", start);
+	start = ticks();
+	for (i = 0 ; i < loops ; i++)
+		read(0,buf,0);
+	report("read(0)", start);
+	if (pipe(fd) < 0) {
+		perror("sysbench: pipe");
+		exit(1);
+	}
+	start = ticks();
+	for (i = 0 ; i < loops ; i++) {
+		write(fd[1],buf,1);
+		read(fd[0],buf,1);
+	}
+	report("pipe w+r", start);
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+ *  linux/tools/vsbench.c
+ *
+ *  (C) 1991  Linus Torvalds
+ */
+
+/*
+ * vsbench runs on the host, not on the new kernel: it compiles
+ * kernel/vsprintf.c into itself, checks what it makes of a set of
+ * formats against the C library's sprintf, checks that vsnprintf()
+ * doesn't write past its limit, and then times both on a printk-like
+ * line:
+ *
+ *	vsbench [loops]
+ *
+ * It returns non-zero if any of the checks fail. do_div() in
+ * vsprintf.c is i386 asm, so this has to be built for the i386.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#define vsprintf kernel_vsprintf
+#define vsnprintf kernel_vsnprintf
+#include "../kernel/vsprintf.c"
+#undef vsprintf
+#undef vsnprintf
+
+#define DEFAULT_LOOPS 200000
+
+static int errors = 0;
+
+static int ksprintf(char * buf, const char * fmt, ...)
+{
+	va_list args;
+	int i;
+
+	va_start(args, fmt);
+	i = kernel_vsprintf(buf, fmt, args);
+	va_end(args);
+	return i;
+}
+
+static int ksnprintf(char * buf, int size, const char * fmt, ...)
+{
+	va_list args;
+	int i;
+
+	va_start(args, fmt);
+	i = kernel_vsnprintf(buf, size, fmt, args);
+	va_end(args);
+	return i;
+}
+
+static void check(const char * fmt, long val)
+{
+	char kbuf[128], cbuf[128];
+	int k, c;
+
+	k = ksprintf(kbuf, fmt, val);
+	c = sprintf(cbuf, fmt, val);
+	if (k != c || strcmp(kbuf, cbuf)) {
+		printf("\"%s\" %ld: got \"%s\" (%d), want \"%s\" (%d)\n",
+			fmt, val, kbuf, k, cbuf, c);
+		errors++;
+	}
+}
+
+static void check_str(const char * fmt, const char * s)
+{
+	char kbuf[128], cbuf[128];
+	int k, c;
+
+	k = ksprintf(kbuf, fmt, s);
+	c = sprintf(cbuf, fmt, s);
+	if (k != c || strcmp(kbuf, cbuf)) {
+		printf("\"%s\" \"%s\": got \"%s\" (%d), want \"%s\" (%d)\n",
+			fmt, s, kbuf, k, cbuf, c);
+		errors++;
+	}
+}
+
+static void check_bounds(void)
+{
+	char buf[32];
+	int size, i;
+
+	for (size = 0 ; size < 20 ; size++) {
+		memset(buf, '#', sizeof(buf));
+		i = ksnprintf(buf, size, "pid %d: %s", 12345, "hello");
+		if (i != 16)
+			errors++, printf("vsnprintf(%d) returned %d\n", size, i);
+		for (i = size ; i < sizeof(buf) ; i++)
+			if (buf[i] != '#') {
+				errors++;
+				printf("vsnprintf(%d) wrote at %d\n", size, i);
+				break;
+			}
+		if (size && (strlen(buf) != (size > 16 ? 16 : size-1)))
+			errors++, printf("vsnprintf(%d) bad termination\n", size);
+	}
+}
+
+static const char * num_fmts[] = {
+	"%d", "%i", "%u", "%x", "%X", "%o", "%5d", "%-5d|", "%05d", "%+d",
+	"% d", "%.3d", "%8.3d", "%-8x|", "%08X", "%#x", "%#o", "%#10x",
+	"[%3u]", "%c", NULL
+};
+
+static long num_vals[] = {
+	1, 7, 9, 10, 42, 99, 100, 101, 999, 1000, 4096, 65535, 99999,
+	1234567, 10000000, 2147483647L, -1, -9, -10, -100, -12345,
+	-2147483647L-1
+};
+
+static const char * str_fmts[] = {
+	"%s", "%10s|", "%-10s|", "%.2s", "%5.1s|", "<%s>", NULL
+};
+
+static const char * str_vals[] = {
+	"", "a", "hello", "a longer string than the field"
+};
+
+static double seconds(clock_t t)
+{
+	return (double) (clock() - t) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char ** argv)
+{
+	char buf[256];
+	long loops = DEFAULT_LOOPS, i;
+	int f, v;
+	clock_t t;
+	double k, c;
+
+	if (argc > 1 && (loops = atol(argv[1])) <= 0)
+		loops = DEFAULT_LOOPS;
+	for (f = 0 ; num_fmts[f] ; f++)
+		for (v = 0 ; v < sizeof(num_vals)/sizeof(long) ; v++) {
+			if (num_fmts[f][1] == 'c' && (num_vals[v] < 32 ||
+			    num_vals[v] > 126))
+				continue;
+			check(num_fmts[f], num_vals[v]);
+		}
+	for (f = 0 ; str_fmts[f] ; f++)
+		for (v = 0 ; v < sizeof(str_vals)/sizeof(char *) ; v++)
+			check_str(str_fmts[f], str_vals[v]);
+	check_bounds();
+	printf("%d errors\n", errors);
+
+	t = clock();
+	for (i = 0 ; i < loops ; i++)
+		ksprintf(buf, "%d: pid=%d, state=%d, %d (of %d) chars free "
+			"in kernel stack, mem %08x\n\r", (int) i, 1234, 1,
+			3072, 4096, 0x12345000);
+	k = seconds(t);
+	t = clock();
+	for (i = 0 ; i < loops ; i++)
+		sprintf(buf, "%d: pid=%d, state=%d, %d (of %d) chars free "
+			"in kernel stack, mem %08x\n\r", (int) i, 1234, 1,
+			3072, 4096, 0x12345000);
+	c = seconds(t);
+	printf("kernel vsprintf: %ld lines in %.3f s (%.0f ns/line)\n",
+		loops, k, k * 1e9 / loops);
+	printf("libc sprintf:    %ld lines in %.3f s (%.0f ns/line)\n",
+		loops, c, c * 1e9 / loops);
+	return errors != 0;
+}